@@ -0,0 +1,116 @@
+/**
+ * MinGUI
+ * Released under the MIT license, (c) Neil Rao
+ */
+
+// Checks that mingui keeps behaving, built as its own program (MinUIChecks)
+// so the sample game stays a game. The checks run every frame for a fixed
+// number of frames on the virtual clock, each prints one line at the end, and
+// the program exits with 1 if any failed.
+
+#include "mingui.h"
+
+#include <iostream>
+
+const int check_frames = 120;
+int failed_checks = 0;
+
+static void report(const char* name, int errors, const Rocket::Core::String& detail)
+{
+	std::cout << name << ": " << (errors == 0 ? "ok" : "FAILED") << " (" << detail.CString() << ")" << std::endl;
+	if (errors > 0)
+		failed_checks++;
+}
+
+
+// pooling: a labelled box destroyed and created again every frame comes back
+// from the pools, the label with the same text node, and the box's reference
+// count is the same every frame.
+Widget cycled_box = NULL;
+Rocket::Core::Element* cycled_text = NULL;
+int cycled_refs = 0;
+int pooling_errors = 0;
+
+static void checkPooling()
+{
+	if (cycled_box != NULL)
+		destroy(cycled_box);
+
+	cycled_box = create_container();
+	Widget label = create_text("pooled");
+	attach(label, cycled_box);
+
+	Rocket::Core::Element* text = get_child(label, 0);
+	if (cycled_text != NULL && text != cycled_text)
+		pooling_errors++;
+	cycled_text = text;
+
+	if (cycled_refs == 0)
+		cycled_refs = cycled_box->GetReferenceCount();
+	else if (cycled_box->GetReferenceCount() != cycled_refs)
+		pooling_errors++;
+
+	if (get_frame_count() == check_frames - 1)
+		report("pooling", pooling_errors, Rocket::Core::String(64, "%d bad frames, box held %d times", pooling_errors, cycled_box->GetReferenceCount()));
+}
+
+
+// translation: two boxes placed alike by their margins, one of them
+// translated. The translated one stays the same distance from the other every
+// frame, however often translations are applied.
+Widget translated_box = NULL;
+Widget reference_box = NULL;
+const float box_dx = 30, box_dy = 20;
+int translation_errors = 0;
+
+static void startTranslationCheck()
+{
+	reference_box = create_container();
+	translated_box = create_container();
+
+	Widget boxes[] = { reference_box, translated_box };
+	for (int i = 0; i < 2; i++)
+	{
+		set_width(boxes[i], 4);
+		set_height(boxes[i], 4);
+		set_position(boxes[i], 300, 200);
+	}
+
+	set_translation(translated_box, box_dx, box_dy);
+}
+
+static void checkTranslation()
+{
+	Rocket::Core::Vector2f moved = translated_box->GetAbsoluteOffset(Rocket::Core::Box::BORDER) - reference_box->GetAbsoluteOffset(Rocket::Core::Box::BORDER);
+	if (moved.x != box_dx || moved.y != box_dy)
+		translation_errors++;
+
+	if (get_frame_count() == check_frames - 1)
+		report("translation", translation_errors, Rocket::Core::String(64, "%d frames off, last %g, %g", translation_errors, moved.x, moved.y));
+}
+
+
+static int run_checks()
+{
+	// frame 0 only sees what was set up before the first layout, which undoes that frame's translation
+	if (get_frame_count() > 0)
+	{
+		checkPooling();
+		checkTranslation();
+	}
+
+	return 1;
+}
+
+int main(int argc, char **argv)
+{
+	create_window("MinGUI checks", 640, 480);
+	load_font("./fonts/ClassicRobotBoldItalic.ttf");
+
+	startTranslationCheck();
+
+	set_virtual_time(1000.0f / 60, check_frames);
+	StartGame(run_checks);
+
+	return failed_checks > 0 ? 1 : 0;
+}
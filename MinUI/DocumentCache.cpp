@@ -0,0 +1,450 @@
+/**
+ * MinGUI
+ * Released under the MIT license, (c) Neil Rao
+ */
+
+#include "DocumentCache.h"
+
+#include <SDL.h>
+#include <stdio.h>
+#include <string.h>
+
+// blobs start with this, then the version and the key
+static const char BlobMagic[4] = { 'M', 'G', 'D', 'C' };
+
+// FNV-1a, over the RML and every style sheet it links
+static unsigned int Hash(const char* s, size_t n, unsigned int h)
+{
+	for (size_t i = 0; i < n; i++)
+	{
+		h ^= (unsigned char)s[i];
+		h *= 16777619u;
+	}
+
+	return h;
+}
+
+static void PutU32(std::string& out, unsigned int v)
+{
+	// blobs are a local cache, so native byte order is fine
+	out.append((const char*)&v, sizeof(v));
+}
+
+static void PutString(std::string& out, const Rocket::Core::String& s)
+{
+	PutU32(out, (unsigned int)s.Length());
+	out.append(s.CString(), s.Length());
+}
+
+namespace
+{
+	struct Reader
+	{
+		Reader(const std::string& data) : data(data), pos(0), ok(true) {}
+
+		unsigned int U32()
+		{
+			unsigned int v = 0;
+			if (pos + sizeof(v) > data.size())
+				ok = false;
+			else
+				memcpy(&v, &data[pos], sizeof(v));
+			pos += sizeof(v);
+			return v;
+		}
+
+		Rocket::Core::String String()
+		{
+			unsigned int n = U32();
+			if (!ok || pos + n > data.size())
+			{
+				ok = false;
+				return Rocket::Core::String();
+			}
+
+			Rocket::Core::String s(&data[pos], &data[pos] + n);
+			pos += n;
+			return s;
+		}
+
+		const std::string& data;
+		size_t pos;
+		bool ok;
+	};
+}
+
+// returns the value of name="..." inside one tag, or an empty string
+static std::string TagAttribute(const std::string& tag, const char* name)
+{
+	std::string key = std::string(name) + "=\"";
+	size_t start = tag.find(key);
+	if (start == std::string::npos)
+		return std::string();
+
+	start += key.size();
+	size_t end = tag.find('"', start);
+	return end == std::string::npos ? std::string() : tag.substr(start, end - start);
+}
+
+Rocket::Core::ElementDocument* DocumentCache::Load(Rocket::Core::Context* context, const Rocket::Core::String& path, Timings* timings)
+{
+	double ms = 1000.0 / SDL_GetPerformanceFrequency();
+	Uint64 start = SDL_GetPerformanceCounter();
+
+	Timings local;
+	if (timings == NULL)
+		timings = &local;
+
+	std::string rml;
+	unsigned int key = 0;
+	std::vector<Rocket::Core::String> style_sheets;
+	bool cacheable = ReadFile(path, rml) && Scan(path, rml, key, style_sheets);
+
+	Rocket::Core::String cache_path = path + ".cache";
+
+	if (cacheable)
+	{
+		std::string data;
+		Blob blob;
+
+		if (ReadFile(cache_path, data) && Decode(data, key, blob))
+		{
+			Uint64 decoded = SDL_GetPerformanceCounter();
+			Rocket::Core::ElementDocument* document = Instantiate(context, blob);
+
+			if (document != NULL)
+			{
+				timings->cached = true;
+				timings->parse_ms = (float)((decoded - start) * ms);
+				timings->instantiate_ms = (float)((SDL_GetPerformanceCounter() - decoded) * ms);
+
+				Rocket::Core::GetSystemInterface()->LogMessage(Rocket::Core::Log::LT_INFO, Rocket::Core::String(256, "%s: from cache, parse %.3f ms, instantiate %.3f ms",
+					path.CString(), timings->parse_ms, timings->instantiate_ms));
+				return document;
+			}
+		}
+	}
+
+	Rocket::Core::ElementDocument* document = context->LoadDocument(path);
+
+	timings->cached = false;
+	timings->parse_ms = (float)((SDL_GetPerformanceCounter() - start) * ms);
+	timings->instantiate_ms = 0;
+
+	Rocket::Core::GetSystemInterface()->LogMessage(Rocket::Core::Log::LT_INFO, Rocket::Core::String(256, "%s: from source, parse and instantiate %.3f ms",
+		path.CString(), timings->parse_ms));
+
+	Blob blob;
+	if (document != NULL && cacheable && Capture(document, path, blob))
+	{
+		blob.style_sheets = style_sheets;
+
+		std::string data;
+		Encode(blob, key, data);
+
+		FILE* f;
+#ifdef WIN32
+		if (fopen_s(&f, cache_path.CString(), "wb") != 0)
+			f = NULL;
+#else
+		f = fopen(cache_path.CString(), "wb");
+#endif
+		if (f != NULL)
+		{
+			fwrite(data.data(), 1, data.size(), f);
+			fclose(f);
+		}
+	}
+
+	return document;
+}
+
+bool DocumentCache::ReadFile(const Rocket::Core::String& path, std::string& data)
+{
+	Rocket::Core::FileInterface* files = Rocket::Core::GetFileInterface();
+	Rocket::Core::FileHandle f = files->Open(path);
+	if (!f)
+		return false;
+
+	data.resize(files->Length(f));
+	size_t read = data.empty() ? 0 : files->Read(&data[0], data.size(), f);
+	files->Close(f);
+
+	return read == data.size();
+}
+
+bool DocumentCache::Scan(const Rocket::Core::String& path, const std::string& rml, unsigned int& key, std::vector<Rocket::Core::String>& style_sheets)
+{
+	// these run code or add rules the blob has no place for
+	if (rml.find("<style") != std::string::npos || rml.find("<script") != std::string::npos || rml.find("<template") != std::string::npos)
+		return false;
+
+	unsigned int version = Version;
+	key = Hash((const char*)&version, sizeof(version), 2166136261u);
+	key = Hash(rml.data(), rml.size(), key);
+
+	for (size_t pos = rml.find("<link"); pos != std::string::npos; pos = rml.find("<link", pos + 1))
+	{
+		size_t end = rml.find('>', pos);
+		if (end == std::string::npos)
+			return false;
+
+		std::string tag = rml.substr(pos, end - pos);
+		std::string type = TagAttribute(tag, "type");
+
+		if (type == "text/template")
+			return false;
+		if (type != "text/rcss")
+			continue;
+
+		// resolved the same way libRocket resolves it
+		Rocket::Core::String style_sheet;
+		Rocket::Core::GetSystemInterface()->JoinPath(style_sheet, path, Rocket::Core::String(TagAttribute(tag, "href").c_str()));
+
+		std::string rcss;
+		if (!ReadFile(style_sheet, rcss))
+			return false;
+
+		key = Hash(rcss.data(), rcss.size(), key);
+		style_sheets.push_back(style_sheet);
+	}
+
+	return true;
+}
+
+bool DocumentCache::Capture(Rocket::Core::ElementDocument* document, const Rocket::Core::String& path, Blob& blob)
+{
+	blob.title = document->GetTitle();
+	blob.roots = document->GetNumChildren();
+	CaptureAttributes(document, path, blob.attributes);
+
+	for (int i = 0; i < document->GetNumChildren(); i++)
+		if (!CaptureElement(document->GetChild(i), path, blob.nodes))
+			return false;
+
+	return true;
+}
+
+bool DocumentCache::CaptureElement(Rocket::Core::Element* element, const Rocket::Core::String& path, std::vector<Node>& nodes)
+{
+	const Rocket::Core::String& tag = element->GetTagName();
+
+	// these move their children out of the DOM while loading, so the DOM can't rebuild them
+	if (tag == "tabset" || tag == "select" || tag == "dataselect" || tag == "datagrid" || tag == "datagridexpand")
+		return false;
+
+	size_t index = nodes.size();
+	nodes.push_back(Node());
+	nodes[index].tag = tag;
+	nodes[index].children = element->GetNumChildren();
+
+	Rocket::Core::ElementText* text = dynamic_cast<Rocket::Core::ElementText*>(element);
+	if (text != NULL)
+	{
+		nodes[index].tag = "#text";
+		text->GetText().ToUTF8(nodes[index].text);
+	}
+
+	CaptureAttributes(element, path, nodes[index].attributes);
+
+	for (int i = 0; i < element->GetNumChildren(); i++)
+		if (!CaptureElement(element->GetChild(i), path, nodes))
+			return false;
+
+	return true;
+}
+
+void DocumentCache::CaptureAttributes(Rocket::Core::Element* element, const Rocket::Core::String& path, std::vector<std::pair<Rocket::Core::String, Rocket::Core::String> >& attributes)
+{
+	int iterator = 0;
+	Rocket::Core::String name, value;
+	while (element->IterateAttributes(iterator, name, value))
+	{
+		// a rebuilt document has no source URL, so image paths are made relative to the working directory
+		if (name == "src" && element->GetTagName() == "img")
+		{
+			Rocket::Core::String joined;
+			Rocket::Core::GetSystemInterface()->JoinPath(joined, path, value);
+			value = joined;
+		}
+
+		attributes.push_back(std::make_pair(name, value));
+	}
+}
+
+void DocumentCache::Encode(const Blob& blob, unsigned int key, std::string& data)
+{
+	data.append(BlobMagic, sizeof(BlobMagic));
+	PutU32(data, Version);
+	PutU32(data, key);
+
+	PutString(data, blob.title);
+
+	PutU32(data, (unsigned int)blob.style_sheets.size());
+	for (size_t i = 0; i < blob.style_sheets.size(); i++)
+		PutString(data, blob.style_sheets[i]);
+
+	PutU32(data, (unsigned int)blob.attributes.size());
+	for (size_t i = 0; i < blob.attributes.size(); i++)
+	{
+		PutString(data, blob.attributes[i].first);
+		PutString(data, blob.attributes[i].second);
+	}
+
+	PutU32(data, (unsigned int)blob.roots);
+	PutU32(data, (unsigned int)blob.nodes.size());
+	for (size_t i = 0; i < blob.nodes.size(); i++)
+	{
+		const Node& node = blob.nodes[i];
+		PutString(data, node.tag);
+		PutString(data, node.text);
+		PutU32(data, (unsigned int)node.children);
+
+		PutU32(data, (unsigned int)node.attributes.size());
+		for (size_t j = 0; j < node.attributes.size(); j++)
+		{
+			PutString(data, node.attributes[j].first);
+			PutString(data, node.attributes[j].second);
+		}
+	}
+}
+
+bool DocumentCache::Decode(const std::string& data, unsigned int key, Blob& blob)
+{
+	if (data.size() < sizeof(BlobMagic) || memcmp(data.data(), BlobMagic, sizeof(BlobMagic)) != 0)
+		return false;
+
+	Reader in(data);
+	in.pos = sizeof(BlobMagic);
+
+	// a different version or key means the blob is stale
+	if (in.U32() != Version || in.U32() != key || !in.ok)
+		return false;
+
+	blob.title = in.String();
+
+	unsigned int style_sheets = in.U32();
+	for (unsigned int i = 0; i < style_sheets && in.ok; i++)
+		blob.style_sheets.push_back(in.String());
+
+	unsigned int root_attributes = in.U32();
+	for (unsigned int i = 0; i < root_attributes && in.ok; i++)
+	{
+		Rocket::Core::String name = in.String();
+		blob.attributes.push_back(std::make_pair(name, in.String()));
+	}
+
+	blob.roots = (int)in.U32();
+	unsigned int nodes = in.U32();
+	if (!in.ok || nodes > data.size())
+		return false;
+
+	blob.nodes.resize(nodes);
+	for (unsigned int i = 0; i < nodes && in.ok; i++)
+	{
+		Node& node = blob.nodes[i];
+		node.tag = in.String();
+		node.text = in.String();
+		node.children = (int)in.U32();
+
+		unsigned int attributes = in.U32();
+		for (unsigned int j = 0; j < attributes && in.ok; j++)
+		{
+			Rocket::Core::String name = in.String();
+			node.attributes.push_back(std::make_pair(name, in.String()));
+		}
+	}
+
+	return in.ok && in.pos == data.size();
+}
+
+Rocket::Core::ElementDocument* DocumentCache::Instantiate(Rocket::Core::Context* context, const Blob& blob)
+{
+	Rocket::Core::ElementDocument* document = context->CreateDocument();
+	if (document == NULL)
+		return NULL;
+
+	document->SetTitle(blob.title);
+
+	// combined in link order, like the document header does it
+	Rocket::Core::StyleSheet* style_sheet = NULL;
+	for (size_t i = 0; i < blob.style_sheets.size(); i++)
+	{
+		Rocket::Core::StyleSheet* sheet = Rocket::Core::Factory::InstanceStyleSheetFile(blob.style_sheets[i]);
+		if (sheet == NULL)
+			continue;
+
+		if (style_sheet == NULL)
+			style_sheet = sheet;
+		else
+		{
+			Rocket::Core::StyleSheet* combined = style_sheet->CombineStyleSheet(sheet);
+			style_sheet->RemoveReference();
+			sheet->RemoveReference();
+			style_sheet = combined;
+		}
+	}
+
+	if (style_sheet != NULL)
+	{
+		document->SetStyleSheet(style_sheet);
+		style_sheet->RemoveReference();
+	}
+
+	document->LockLayout(true);
+
+	// id, class, style and on* handlers on the body itself
+	for (size_t i = 0; i < blob.attributes.size(); i++)
+		document->SetAttribute(blob.attributes[i].first, blob.attributes[i].second);
+
+	InstantiateChildren(document, document, blob.nodes, 0, blob.roots);
+	document->LockLayout(false);
+
+	// as Context::LoadDocument() does, so onload handlers run either way
+	document->DispatchEvent("load", Rocket::Core::Dictionary(), false);
+
+	return document;
+}
+
+size_t DocumentCache::InstantiateChildren(Rocket::Core::ElementDocument* document, Rocket::Core::Element* parent, const std::vector<Node>& nodes, size_t index, int count)
+{
+	for (int i = 0; i < count && index < nodes.size(); i++)
+	{
+		const Node& node = nodes[index++];
+
+		// a NULL parent means an ancestor failed to instance; skip over its subtree
+		if (parent == NULL)
+		{
+			index = InstantiateChildren(document, NULL, nodes, index, node.children);
+			continue;
+		}
+
+		if (node.tag == "#text")
+		{
+			Rocket::Core::ElementText* text = document->CreateTextNode(node.text);
+			if (text != NULL)
+			{
+				parent->AppendChild(text);
+				text->RemoveReference();
+			}
+
+			index = InstantiateChildren(document, NULL, nodes, index, node.children);
+			continue;
+		}
+
+		Rocket::Core::XMLAttributes attributes;
+		for (size_t j = 0; j < node.attributes.size(); j++)
+			attributes.Set(node.attributes[j].first, node.attributes[j].second);
+
+		Rocket::Core::Element* element = Rocket::Core::Factory::InstanceElement(parent, node.tag, node.tag, attributes);
+		if (element != NULL)
+		{
+			parent->AppendChild(element);
+			element->RemoveReference();
+		}
+
+		index = InstantiateChildren(document, element, nodes, index, node.children);
+	}
+
+	return index;
+}
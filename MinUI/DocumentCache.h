@@ -0,0 +1,76 @@
+/**
+ * MinGUI
+ * Released under the MIT license, (c) Neil Rao
+ */
+
+#ifndef DOCUMENTCACHE_H
+#define DOCUMENTCACHE_H
+
+#include <Rocket/Core.h>
+
+#include <string>
+#include <vector>
+
+/**
+ * Loads RML documents through a binary cache. The first load parses the RML
+ * as usual and writes the resulting element tree (tags, attributes, text) and
+ * the list of linked style sheets to <file>.cache. Later loads whose RML and
+ * RCSS bytes hash to the same key rebuild the document straight from the
+ * cache, without tokenizing or parsing any markup, and send "load" as a
+ * source load does. Only the RML is cached: style sheets are reloaded by
+ * path, so their RCSS is still parsed once per run, and libRocket's style
+ * sheet cache serves later loads in the same run.
+ *
+ * Documents with inline styles, scripts or templates, and documents using
+ * controls that rearrange their children (tab sets, selects, data grids) are
+ * always loaded from source.
+ */
+class DocumentCache
+{
+public:
+	/// Bump when the blob layout changes; old blobs are then rebuilt from source.
+	static const unsigned int Version = 2;
+
+	struct Timings
+	{
+		bool cached;			// rebuilt from the cache
+		float parse_ms;			// reading and decoding the blob; for source loads, parsing and instancing together
+		float instantiate_ms;	// creating the elements from the blob; zero for source loads
+	};
+
+	/// Loads a document into the context, from the cache if it is current.
+	static Rocket::Core::ElementDocument* Load(Rocket::Core::Context* context, const Rocket::Core::String& path, Timings* timings = NULL);
+
+private:
+	struct Node
+	{
+		Rocket::Core::String tag;		// "#text" for text
+		Rocket::Core::String text;
+		std::vector<std::pair<Rocket::Core::String, Rocket::Core::String> > attributes;
+		int children;					// number of nodes directly below, which follow this one in depth-first order
+	};
+
+	struct Blob
+	{
+		Rocket::Core::String title;
+		std::vector<Rocket::Core::String> style_sheets;
+		std::vector<std::pair<Rocket::Core::String, Rocket::Core::String> > attributes;	// the body's own
+		int roots;						// number of nodes directly below the body
+		std::vector<Node> nodes;		// the body's subtree, depth first
+	};
+
+	static bool ReadFile(const Rocket::Core::String& path, std::string& data);
+	static bool Scan(const Rocket::Core::String& path, const std::string& rml, unsigned int& key, std::vector<Rocket::Core::String>& style_sheets);
+
+	static bool Capture(Rocket::Core::ElementDocument* document, const Rocket::Core::String& path, Blob& blob);
+	static bool CaptureElement(Rocket::Core::Element* element, const Rocket::Core::String& path, std::vector<Node>& nodes);
+	static void CaptureAttributes(Rocket::Core::Element* element, const Rocket::Core::String& path, std::vector<std::pair<Rocket::Core::String, Rocket::Core::String> >& attributes);
+
+	static void Encode(const Blob& blob, unsigned int key, std::string& data);
+	static bool Decode(const std::string& data, unsigned int key, Blob& blob);
+
+	static Rocket::Core::ElementDocument* Instantiate(Rocket::Core::Context* context, const Blob& blob);
+	static size_t InstantiateChildren(Rocket::Core::ElementDocument* document, Rocket::Core::Element* parent, const std::vector<Node>& nodes, size_t index, int count);
+};
+
+#endif
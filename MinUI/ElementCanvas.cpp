@@ -0,0 +1,194 @@
+/**
+ * MinGUI
+ * Released under the MIT license, (c) Neil Rao
+ */
+
+#include <Rocket/Core.h>
+#include <Rocket/Core/GeometryUtilities.h>
+#include "ElementCanvas.h"
+#include "RenderInterfaceSDL2.h"
+
+#include <algorithm>
+
+ElementCanvas::ElementCanvas(const Rocket::Core::String& tag) : Rocket::Core::Element(tag)
+{
+	mWidth = 0;
+	mHeight = 0;
+	mRenderInterface = NULL;
+	mStreaming = false;
+	mFront = 0;
+
+	for (int i = 0; i < NumTextures; i++)
+		mTextures[i] = 0;
+}
+
+ElementCanvas::~ElementCanvas()
+{
+	ReleaseTextures();
+}
+
+void ElementCanvas::Initialise(int width, int height)
+{
+	mWidth = width > 0 ? width : 0;
+	mHeight = height > 0 ? height : 0;
+	mPixels.assign(mWidth * mHeight * 4, 0);
+
+	// the texture size follows the buffer's
+	ReleaseTextures();
+
+	Rocket::Core::GeometryUtilities::GenerateQuad(mVertices, mIndices, Rocket::Core::Vector2f(0, 0), Rocket::Core::Vector2f((float)mWidth, (float)mHeight), Rocket::Core::Colourb(255, 255, 255, 255));
+	DirtyLayout();
+}
+
+void ElementCanvas::MarkDirty(int x, int y, int width, int height)
+{
+	Rect rect;
+	rect.x = std::max(x, 0);
+	rect.y = std::max(y, 0);
+	rect.width = std::min(x + width, mWidth) - rect.x;
+	rect.height = std::min(y + height, mHeight) - rect.y;
+
+	if (rect.width <= 0 || rect.height <= 0)
+		return;
+
+	for (int i = 0; i < NumTextures; i++)
+		AddPending(i, rect);
+}
+
+void ElementCanvas::AddPending(int texture, const Rect& rect)
+{
+	std::vector<Rect>& pending = mPending[texture];
+
+	for (size_t i = 0; i < pending.size(); i++)
+	{
+		const Rect& r = pending[i];
+		if (rect.x >= r.x && rect.y >= r.y && rect.x + rect.width <= r.x + r.width && rect.y + rect.height <= r.y + r.height)
+			return;
+	}
+
+	if (pending.size() < MaxPendingRects)
+	{
+		pending.push_back(rect);
+		return;
+	}
+
+	// many small uploads cost more than one larger one
+	Rect bounds = rect;
+	for (size_t i = 0; i < pending.size(); i++)
+	{
+		const Rect& r = pending[i];
+		int right = std::max(bounds.x + bounds.width, r.x + r.width);
+		int bottom = std::max(bounds.y + bounds.height, r.y + r.height);
+		bounds.x = std::min(bounds.x, r.x);
+		bounds.y = std::min(bounds.y, r.y);
+		bounds.width = right - bounds.x;
+		bounds.height = bottom - bounds.y;
+	}
+
+	pending.assign(1, bounds);
+}
+
+bool ElementCanvas::CreateTextures(Rocket::Core::RenderInterface* render_interface)
+{
+	mRenderInterface = render_interface;
+	mFront = 0;
+
+	Rect all = { 0, 0, mWidth, mHeight };
+
+	RocketSDL2Renderer* sdl_renderer = dynamic_cast<RocketSDL2Renderer*>(render_interface);
+	mStreaming = sdl_renderer != NULL;
+
+	if (mStreaming)
+	{
+		for (int i = 0; i < NumTextures; i++)
+		{
+			mTextures[i] = sdl_renderer->CreateStreamingTexture(Rocket::Core::Vector2i(mWidth, mHeight));
+			if (!mTextures[i])
+			{
+				ReleaseTextures();
+				return false;
+			}
+
+			mPending[i].assign(1, all);
+		}
+
+		return true;
+	}
+
+	if (!render_interface->GenerateTexture(mTextures[0], &mPixels[0], Rocket::Core::Vector2i(mWidth, mHeight)))
+	{
+		mTextures[0] = 0;
+		return false;
+	}
+
+	for (int i = 0; i < NumTextures; i++)
+		mPending[i].clear();
+
+	return true;
+}
+
+void ElementCanvas::ReleaseTextures()
+{
+	for (int i = 0; i < NumTextures; i++)
+	{
+		if (mTextures[i] && mRenderInterface)
+			mRenderInterface->ReleaseTexture(mTextures[i]);
+
+		mTextures[i] = 0;
+		mPending[i].clear();
+	}
+
+	mRenderInterface = NULL;
+}
+
+void ElementCanvas::OnRender()
+{
+	if (mPixels.empty())
+		return;
+
+	Rocket::Core::RenderInterface* render_interface = GetRenderInterface();
+	if (render_interface != mRenderInterface)
+	{
+		ReleaseTextures();
+		if (!CreateTextures(render_interface))
+			return;
+	}
+
+	if (mStreaming)
+	{
+		// bring the texture not drawn last frame up to date, then draw it
+		int back = (mFront + 1) % NumTextures;
+		std::vector<Rect>& pending = mPending[back];
+
+		if (!pending.empty())
+		{
+			RocketSDL2Renderer* sdl_renderer = static_cast<RocketSDL2Renderer*>(render_interface);
+			for (size_t i = 0; i < pending.size(); i++)
+			{
+				const Rect& r = pending[i];
+				sdl_renderer->UpdateTexture(mTextures[back], r.x, r.y, r.width, r.height, &mPixels[(r.y * mWidth + r.x) * 4], GetPitch());
+			}
+
+			pending.clear();
+			mFront = back;
+		}
+	}
+	else if (!mPending[0].empty())
+	{
+		render_interface->ReleaseTexture(mTextures[0]);
+		mTextures[0] = 0;
+		if (!render_interface->GenerateTexture(mTextures[0], &mPixels[0], Rocket::Core::Vector2i(mWidth, mHeight)))
+			return;
+
+		for (int i = 0; i < NumTextures; i++)
+			mPending[i].clear();
+	}
+
+	render_interface->RenderGeometry(mVertices, 4, mIndices, 6, mTextures[mFront], GetAbsoluteOffset(Rocket::Core::Box::CONTENT));
+}
+
+bool ElementCanvas::GetIntrinsicDimensions(Rocket::Core::Vector2f& dimensions)
+{
+	dimensions = Rocket::Core::Vector2f((float)mWidth, (float)mHeight);
+	return true;
+}
@@ -0,0 +1,75 @@
+/**
+ * MinGUI
+ * Released under the MIT license, (c) Neil Rao
+ */
+
+#ifndef ELEMENTCANVAS_H
+#define ELEMENTCANVAS_H
+
+#include <Rocket/Core/Element.h>
+#include <Rocket/Core/RenderInterface.h>
+#include <Rocket/Core/Vertex.h>
+
+#include <vector>
+
+/**
+ * A width x height RGBA pixel buffer that lives in memory and is drawn as one
+ * textured quad. Programs write pixels directly and mark the rectangles they
+ * changed; the next render uploads only those rectangles.
+ *
+ * The canvas keeps two streaming textures and alternates between them, so an
+ * upload never writes into the texture the previous frame is still drawing
+ * from. Each texture remembers the rectangles it has not received yet.
+ * Renderers other than RocketSDL2Renderer get a plain texture that is
+ * regenerated whole when anything changes.
+ */
+class ElementCanvas : public Rocket::Core::Element
+{
+public:
+	ElementCanvas(const Rocket::Core::String& tag);
+	virtual ~ElementCanvas();
+
+	/// Allocates the buffer, cleared to transparent black.
+	void Initialise(int width, int height);
+
+	/// Rows of width RGBA pixels, top to bottom; GetPitch() bytes apart.
+	Rocket::Core::byte* GetPixels() { return mPixels.empty() ? NULL : &mPixels[0]; }
+	int GetWidth() const { return mWidth; }
+	int GetHeight() const { return mHeight; }
+	int GetPitch() const { return mWidth * 4; }
+
+	/// Marks a rectangle of the buffer as changed. It is clipped to the buffer.
+	void MarkDirty(int x, int y, int width, int height);
+
+protected:
+	virtual void OnRender();
+	virtual bool GetIntrinsicDimensions(Rocket::Core::Vector2f& dimensions);
+
+private:
+	struct Rect
+	{
+		int x, y, width, height;
+	};
+
+	static const int NumTextures = 2;
+	static const size_t MaxPendingRects = 16; // past this, a texture's rects merge into their bounds
+
+	bool CreateTextures(Rocket::Core::RenderInterface* render_interface);
+	void ReleaseTextures();
+	void AddPending(int texture, const Rect& rect);
+
+	int mWidth;
+	int mHeight;
+	std::vector<Rocket::Core::byte> mPixels;
+
+	Rocket::Core::RenderInterface* mRenderInterface; // the textures were made by this; NULL before the first render
+	bool mStreaming;
+	Rocket::Core::TextureHandle mTextures[NumTextures];
+	std::vector<Rect> mPending[NumTextures];
+	int mFront; // the texture last drawn
+
+	Rocket::Core::Vertex mVertices[4];
+	int mIndices[6];
+};
+
+#endif
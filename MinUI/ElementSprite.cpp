@@ -0,0 +1,122 @@
+/**
+ * MinGUI
+ * Released under the MIT license, (c) Neil Rao
+ */
+
+#include <Rocket/Core.h>
+#include <Rocket/Core/GeometryUtilities.h>
+#include "ElementSprite.h"
+
+ElementSprite::ElementSprite(const Rocket::Core::String& tag) : Rocket::Core::Element(tag)
+{
+	mCols = 1;
+	mRows = 1;
+	mFirst = 0;
+	mCount = 1;
+	mFps = 0;
+	mStart = 0;
+	mScale = 1;
+	mOpacity = 1;
+	mSheetDimensions = Rocket::Core::Vector2i(0, 0);
+	mFrame = -1;
+}
+
+ElementSprite::~ElementSprite()
+{
+}
+
+void ElementSprite::Initialise(const Rocket::Core::String& sheet, int cols, int rows, float fps)
+{
+	mCols = cols > 0 ? cols : 1;
+	mRows = rows > 0 ? rows : 1;
+
+	mSheet.Load(sheet);
+	mSheetDimensions = Rocket::Core::Vector2i(0, 0);
+
+	SetAnimation(0, mCols * mRows, fps);
+	DirtyLayout();
+}
+
+void ElementSprite::SetAnimation(int first, int count, float fps)
+{
+	mFirst = first >= 0 ? first : 0;
+	mCount = count > 0 ? count : 1;
+	mFps = fps > 0 ? fps : 0;
+	mStart = Rocket::Core::GetSystemInterface()->GetElapsedTime();
+}
+
+void ElementSprite::SetScale(float scale)
+{
+	if (scale == mScale)
+		return;
+
+	mScale = scale;
+	mFrame = -1;
+}
+
+void ElementSprite::SetOpacity(float opacity)
+{
+	opacity = opacity < 0 ? 0 : (opacity > 1 ? 1 : opacity);
+	if (opacity == mOpacity)
+		return;
+
+	mOpacity = opacity;
+	mFrame = -1;
+}
+
+int ElementSprite::CurrentFrame() const
+{
+	int step = 0;
+	if (mFps > 0 && mCount > 1)
+		step = (int)((Rocket::Core::GetSystemInterface()->GetElapsedTime() - mStart) * mFps) % mCount;
+
+	int frame = mFirst + (step > 0 ? step : 0);
+	int frames = mCols * mRows;
+	return frame < frames ? frame : frames - 1;
+}
+
+void ElementSprite::OnRender()
+{
+	Rocket::Core::RenderInterface* render_interface = GetRenderInterface();
+
+	if (mSheetDimensions.x == 0)
+	{
+		mSheetDimensions = mSheet.GetDimensions(render_interface);
+		if (mSheetDimensions.x == 0)
+			return;
+	}
+
+	int frame = CurrentFrame();
+	if (frame != mFrame)
+	{
+		mFrame = frame;
+		GenerateQuad();
+	}
+
+	render_interface->RenderGeometry(mVertices, 4, mIndices, 6, mSheet.GetHandle(render_interface), GetAbsoluteOffset(Rocket::Core::Box::CONTENT));
+}
+
+bool ElementSprite::GetIntrinsicDimensions(Rocket::Core::Vector2f& dimensions)
+{
+	// the sheet has to be loaded for layout, as an img's is
+	if (mSheetDimensions.x == 0)
+		mSheetDimensions = mSheet.GetDimensions(GetRenderInterface());
+
+	dimensions = Rocket::Core::Vector2f((float)(mSheetDimensions.x / mCols), (float)(mSheetDimensions.y / mRows));
+	return true;
+}
+
+void ElementSprite::GenerateQuad()
+{
+	Rocket::Core::Vector2f frame_size(1.0f / mCols, 1.0f / mRows);
+	Rocket::Core::Vector2f top_left((mFrame % mCols) * frame_size.x, (mFrame / mCols) * frame_size.y);
+	Rocket::Core::Vector2f bottom_right(top_left.x + frame_size.x, top_left.y + frame_size.y);
+	Rocket::Core::Vector2f size((float)(mSheetDimensions.x / mCols), (float)(mSheetDimensions.y / mRows));
+
+	// scaled about the centre; layout still sees the unscaled size
+	Rocket::Core::Vector2f scaled(size.x * mScale, size.y * mScale);
+	Rocket::Core::Vector2f origin((size.x - scaled.x) * 0.5f, (size.y - scaled.y) * 0.5f);
+	Rocket::Core::Colourb colour(255, 255, 255, (Rocket::Core::byte)(mOpacity * 255));
+
+	Rocket::Core::GeometryUtilities::GenerateQuad(mVertices, mIndices, origin, scaled, colour, top_left, bottom_right);
+}
@@ -0,0 +1,70 @@
+/**
+ * MinGUI
+ * Released under the MIT license, (c) Neil Rao
+ */
+
+#ifndef ELEMENTSPRITE_H
+#define ELEMENTSPRITE_H
+
+#include <Rocket/Core/Element.h>
+#include <Rocket/Core/Texture.h>
+#include <Rocket/Core/Vertex.h>
+
+/**
+ * An animated sprite cut from a sheet of equally sized frames, numbered left
+ * to right, top to bottom. The element is one frame in size. Animation only
+ * moves the quad's texture coordinates, so it never loads a texture or
+ * dirties layout, and every sprite cut from the same sheet shares one
+ * texture through Rocket's texture cache.
+ *
+ * Frames follow the system interface's clock, so virtual time runs animate
+ * reproducibly.
+ */
+class ElementSprite : public Rocket::Core::Element
+{
+public:
+	ElementSprite(const Rocket::Core::String& tag);
+	virtual ~ElementSprite();
+
+	/// Sets the sheet and its grid, and plays every frame at fps.
+	void Initialise(const Rocket::Core::String& sheet, int cols, int rows, float fps);
+
+	/// Plays count frames from first, looping, restarting from first now. An fps of zero holds first.
+	void SetAnimation(int first, int count, float fps);
+
+	int GetFrame() const { return mFrame; }
+
+	/// Draws the frame scaled about its centre, without changing the element's size.
+	void SetScale(float scale);
+	float GetScale() const { return mScale; }
+
+	/// Multiplies the sheet's alpha; 0 is invisible.
+	void SetOpacity(float opacity);
+	float GetOpacity() const { return mOpacity; }
+
+protected:
+	virtual void OnRender();
+	virtual bool GetIntrinsicDimensions(Rocket::Core::Vector2f& dimensions);
+
+private:
+	int CurrentFrame() const;
+	void GenerateQuad();
+
+	int mCols;
+	int mRows;
+	int mFirst;
+	int mCount;
+	float mFps;
+	float mStart; // clock time of frame mFirst
+	float mScale;
+	float mOpacity;
+
+	Rocket::Core::Texture mSheet;
+	Rocket::Core::Vector2i mSheetDimensions; // zero until the sheet has been loaded
+
+	int mFrame; // the frame mVertices show; -1 when they need regenerating
+	Rocket::Core::Vertex mVertices[4];
+	int mIndices[6];
+};
+
+#endif
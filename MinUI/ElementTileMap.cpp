@@ -0,0 +1,125 @@
+/**
+ * MinGUI
+ * Released under the MIT license, (c) Neil Rao
+ */
+
+#include <Rocket/Core.h>
+#include <Rocket/Core/GeometryUtilities.h>
+#include "ElementTileMap.h"
+
+ElementTileMap::ElementTileMap(const Rocket::Core::String& tag) : Rocket::Core::Element(tag), mGeometry(this)
+{
+	mCols = 0;
+	mRows = 0;
+	mCellWidth = 0;
+	mCellHeight = 0;
+	mTileWidth = 0;
+	mTileHeight = 0;
+	mAtlasDimensions = Rocket::Core::Vector2i(0, 0);
+}
+
+ElementTileMap::~ElementTileMap()
+{
+}
+
+void ElementTileMap::Initialise(int cols, int rows, int cell_width, int cell_height, const Rocket::Core::String& atlas, int tile_width, int tile_height)
+{
+	mCols = cols;
+	mRows = rows;
+	mCellWidth = cell_width;
+	mCellHeight = cell_height;
+	mTileWidth = tile_width > 0 ? tile_width : cell_width;
+	mTileHeight = tile_height > 0 ? tile_height : cell_height;
+	mTiles.assign(cols * rows, -1);
+
+	mAtlas.Load(atlas);
+	mAtlasDimensions = Rocket::Core::Vector2i(0, 0);
+	mGeometry.SetTexture(&mAtlas);
+
+	// four vertices and six indices per cell, allocated once
+	mGeometry.GetVertices().resize(cols * rows * 4);
+	mGeometry.GetIndices().resize(cols * rows * 6);
+
+	for (int y = 0; y < rows; y++)
+		for (int x = 0; x < cols; x++)
+			GenerateQuad(x, y);
+
+	mGeometry.Release();
+	DirtyLayout();
+}
+
+void ElementTileMap::SetTile(int x, int y, int tile_id)
+{
+	if (x < 0 || x >= mCols || y < 0 || y >= mRows)
+		return;
+
+	int& tile = mTiles[y * mCols + x];
+	if (tile == tile_id)
+		return;
+
+	tile = tile_id;
+
+	// without atlas dimensions there are no texture coordinates yet; every quad is built once the atlas loads
+	if (mAtlasDimensions.x > 0)
+	{
+		GenerateQuad(x, y);
+		mGeometry.Release();
+	}
+}
+
+int ElementTileMap::GetTile(int x, int y) const
+{
+	if (x < 0 || x >= mCols || y < 0 || y >= mRows)
+		return -1;
+
+	return mTiles[y * mCols + x];
+}
+
+void ElementTileMap::OnRender()
+{
+	if (mAtlasDimensions.x == 0 && !mTiles.empty())
+	{
+		mAtlasDimensions = mAtlas.GetDimensions(GetRenderInterface());
+		if (mAtlasDimensions.x == 0)
+			return;
+
+		for (int y = 0; y < mRows; y++)
+			for (int x = 0; x < mCols; x++)
+				GenerateQuad(x, y);
+
+		mGeometry.Release();
+	}
+
+	mGeometry.Render(GetAbsoluteOffset(Rocket::Core::Box::CONTENT));
+}
+
+bool ElementTileMap::GetIntrinsicDimensions(Rocket::Core::Vector2f& dimensions)
+{
+	dimensions = Rocket::Core::Vector2f((float)(mCols * mCellWidth), (float)(mRows * mCellHeight));
+	return true;
+}
+
+void ElementTileMap::GenerateQuad(int x, int y)
+{
+	int cell = y * mCols + x;
+	int tile_id = mTiles[cell];
+
+	Rocket::Core::Vertex* vertices = &mGeometry.GetVertices()[cell * 4];
+	int* indices = &mGeometry.GetIndices()[cell * 6];
+
+	Rocket::Core::Vector2f origin((float)(x * mCellWidth), (float)(y * mCellHeight));
+	Rocket::Core::Vector2f size((float)mCellWidth, (float)mCellHeight);
+
+	int atlas_cols = mAtlasDimensions.x / mTileWidth;
+	if (tile_id < 0 || atlas_cols == 0)
+	{
+		// empty cells keep their slot as a degenerate, transparent quad
+		Rocket::Core::GeometryUtilities::GenerateQuad(vertices, indices, origin, Rocket::Core::Vector2f(0, 0), Rocket::Core::Colourb(255, 255, 255, 0), cell * 4);
+		return;
+	}
+
+	Rocket::Core::Vector2f top_left((float)((tile_id % atlas_cols) * mTileWidth) / mAtlasDimensions.x, (float)((tile_id / atlas_cols) * mTileHeight) / mAtlasDimensions.y);
+	Rocket::Core::Vector2f bottom_right(top_left.x + (float)mTileWidth / mAtlasDimensions.x, top_left.y + (float)mTileHeight / mAtlasDimensions.y);
+
+	Rocket::Core::GeometryUtilities::GenerateQuad(vertices, indices, origin, size, Rocket::Core::Colourb(255, 255, 255, 255), top_left, bottom_right, cell * 4);
+}
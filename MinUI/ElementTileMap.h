@@ -0,0 +1,59 @@
+/**
+ * MinGUI
+ * Released under the MIT license, (c) Neil Rao
+ */
+
+#ifndef ELEMENTTILEMAP_H
+#define ELEMENTTILEMAP_H
+
+#include <Rocket/Core/Element.h>
+#include <Rocket/Core/Geometry.h>
+#include <Rocket/Core/Texture.h>
+
+#include <vector>
+
+/**
+ * A grid of tiles drawn from one atlas texture. The whole grid is a single
+ * piece of geometry with one quad per cell, so it costs one element and one
+ * draw call however many cells it has. Tile ids index the atlas left to
+ * right, top to bottom, in tiles of tile_width x tile_height atlas pixels;
+ * each tile is stretched to fill a cell. Negative ids are empty.
+ */
+class ElementTileMap : public Rocket::Core::Element
+{
+public:
+	ElementTileMap(const Rocket::Core::String& tag);
+	virtual ~ElementTileMap();
+
+	/// Sets the grid and atlas. All cells start empty. A tile size of zero means the cell size.
+	void Initialise(int cols, int rows, int cell_width, int cell_height, const Rocket::Core::String& atlas, int tile_width = 0, int tile_height = 0);
+
+	/// Changes one cell. Only that cell's quad is regenerated.
+	void SetTile(int x, int y, int tile_id);
+	int GetTile(int x, int y) const;
+
+	int GetColumns() const { return mCols; }
+	int GetRows() const { return mRows; }
+
+protected:
+	virtual void OnRender();
+	virtual bool GetIntrinsicDimensions(Rocket::Core::Vector2f& dimensions);
+
+private:
+	void GenerateQuad(int x, int y);
+
+	int mCols;
+	int mRows;
+	int mCellWidth;
+	int mCellHeight;
+	int mTileWidth;
+	int mTileHeight;
+	std::vector<int> mTiles;
+
+	Rocket::Core::Texture mAtlas;
+	Rocket::Core::Vector2i mAtlasDimensions; // zero until the atlas has been loaded
+
+	Rocket::Core::Geometry mGeometry;
+};
+
+#endif
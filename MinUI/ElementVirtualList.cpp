@@ -0,0 +1,121 @@
+/**
+ * MinGUI
+ * Released under the MIT license, (c) Neil Rao
+ */
+
+#include <Rocket/Core.h>
+#include "ElementVirtualList.h"
+
+#include <algorithm>
+#include <math.h>
+
+ElementVirtualList::ElementVirtualList(const Rocket::Core::String& tag) : Rocket::Core::Element(tag)
+{
+	mItemHeight = 1;
+	mCount = 0;
+	mFill = NULL;
+	mSpacer = NULL;
+}
+
+ElementVirtualList::~ElementVirtualList()
+{
+}
+
+void ElementVirtualList::Initialise(int item_height, int count, FillCallback fill)
+{
+	mItemHeight = item_height > 0 ? item_height : 1;
+	mFill = fill;
+
+	// rows are placed relative to the list and scroll with it
+	SetProperty("position", Rocket::Core::Property(Rocket::Core::POSITION_RELATIVE, Rocket::Core::Property::KEYWORD));
+	SetProperty("overflow-y", Rocket::Core::Property(Rocket::Core::OVERFLOW_AUTO, Rocket::Core::Property::KEYWORD));
+
+	if (mSpacer == NULL)
+	{
+		mSpacer = Rocket::Core::Factory::InstanceElement(this, "div", "div", Rocket::Core::XMLAttributes());
+		AppendChild(mSpacer);
+		mSpacer->RemoveReference();
+	}
+
+	SetCount(count);
+}
+
+void ElementVirtualList::SetCount(int count)
+{
+	mCount = count > 0 ? count : 0;
+
+	if (mSpacer != NULL)
+		mSpacer->SetProperty("height", Rocket::Core::Property((float)(mCount * mItemHeight), Rocket::Core::Property::PX));
+
+	Refresh();
+}
+
+void ElementVirtualList::Refresh()
+{
+	std::fill(mRowIndex.begin(), mRowIndex.end(), -1);
+}
+
+void ElementVirtualList::OnUpdate()
+{
+	Arrange();
+}
+
+void ElementVirtualList::ResizePool(int size)
+{
+	while ((int)mRows.size() < size)
+	{
+		Rocket::Core::Element* row = Rocket::Core::Factory::InstanceElement(this, "div", "div", Rocket::Core::XMLAttributes());
+		row->SetProperty("position", Rocket::Core::Property(Rocket::Core::POSITION_ABSOLUTE, Rocket::Core::Property::KEYWORD));
+		row->SetProperty("left", Rocket::Core::Property(0.0f, Rocket::Core::Property::PX));
+		row->SetProperty("right", Rocket::Core::Property(0.0f, Rocket::Core::Property::PX));
+		row->SetProperty("height", Rocket::Core::Property((float)mItemHeight, Rocket::Core::Property::PX));
+		AppendChild(row);
+		row->RemoveReference();
+
+		mRows.push_back(row);
+	}
+
+	while ((int)mRows.size() > size)
+	{
+		RemoveChild(mRows.back());
+		mRows.pop_back();
+	}
+
+	// the slot a row maps to depends on the pool size
+	mRowIndex.assign(size, -1);
+}
+
+void ElementVirtualList::Arrange()
+{
+	float view_height = GetClientHeight();
+	if (view_height <= 0 || mFill == NULL)
+		return;
+
+	int visible = (int)ceilf(view_height / mItemHeight) + 1;
+	int pool = visible + 2 * Overscan;
+	if (pool != (int)mRows.size())
+		ResizePool(pool);
+
+	int first = (int)(GetScrollTop() / mItemHeight) - Overscan;
+	first = std::max(0, std::min(first, mCount - pool));
+
+	for (int index = first; index < first + pool; index++)
+	{
+		int slot = index % pool;
+		if (mRowIndex[slot] == index)
+			continue;
+
+		Rocket::Core::Element* row = mRows[slot];
+		mRowIndex[slot] = index;
+
+		if (index >= mCount)
+		{
+			row->SetProperty("visibility", Rocket::Core::Property(Rocket::Core::VISIBILITY_HIDDEN, Rocket::Core::Property::KEYWORD));
+			continue;
+		}
+
+		row->SetProperty("visibility", Rocket::Core::Property(Rocket::Core::VISIBILITY_VISIBLE, Rocket::Core::Property::KEYWORD));
+		row->SetProperty("top", Rocket::Core::Property((float)(index * mItemHeight), Rocket::Core::Property::PX));
+		mFill(row, index);
+	}
+}
@@ -0,0 +1,59 @@
+/**
+ * MinGUI
+ * Released under the MIT license, (c) Neil Rao
+ */
+
+#ifndef ELEMENTVIRTUALLIST_H
+#define ELEMENTVIRTUALLIST_H
+
+#include <Rocket/Core/Element.h>
+
+#include <vector>
+
+/**
+ * A scrolling list of count rows, item_height pixels each, where only the
+ * rows in view (plus Overscan on either side) exist as elements. A spacer
+ * as tall as the whole list gives the scroll range, and the row elements
+ * are positioned absolutely over it. Row i always lives in pool slot
+ * i % pool size, so when the list scrolls a slot is only refilled if its
+ * index changed, and the fill callback runs only for rows that came into
+ * view. Element count and per-frame work depend on the list's height, not
+ * on count.
+ */
+class ElementVirtualList : public Rocket::Core::Element
+{
+public:
+	typedef void (*FillCallback)(Rocket::Core::Element* row, int index);
+
+	/// Rows kept beyond each edge of the view, so short scrolls show filled rows.
+	static const int Overscan = 2;
+
+	ElementVirtualList(const Rocket::Core::String& tag);
+	virtual ~ElementVirtualList();
+
+	void Initialise(int item_height, int count, FillCallback fill);
+
+	/// Changes the number of rows. Rows in view are filled again.
+	void SetCount(int count);
+	int GetCount() const { return mCount; }
+
+	/// Fills every row in view again on the next update, e.g. after the data behind them changed.
+	void Refresh();
+
+protected:
+	virtual void OnUpdate();
+
+private:
+	void Arrange();
+	void ResizePool(int size);
+
+	int mItemHeight;
+	int mCount;
+	FillCallback mFill;
+
+	Rocket::Core::Element* mSpacer;
+	std::vector<Rocket::Core::Element*> mRows;	// the pool; owned as children
+	std::vector<int> mRowIndex;					// the row each slot shows, -1 for none
+};
+
+#endif
@@ -0,0 +1,105 @@
+/**
+ * MinGUI
+ * Released under the MIT license, (c) Neil Rao
+ *
+ * A bounded, preallocated, lock-free ring buffer for many producers and a
+ * single consumer. Producers never block: when the ring is full the push
+ * fails and the caller decides what to do (count a drop, retry, ...).
+ */
+
+#ifndef MPSCRINGBUFFER_H
+#define MPSCRINGBUFFER_H
+
+#include <atomic>
+#include <stddef.h>
+
+template <typename T, size_t Capacity>
+class MPSCRingBuffer
+{
+	static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "MPSCRingBuffer capacity must be a power of two");
+
+public:
+	MPSCRingBuffer() : mHead(0), mTail(0)
+	{
+		for (size_t i = 0; i < Capacity; i++)
+			mCells[i].sequence.store(i, std::memory_order_relaxed);
+	}
+
+	/// Claims a slot and lets fill() write the record in place. Safe to call from any thread.
+	/// Returns false without calling fill() if the ring is full.
+	template <typename F>
+	bool TryEmplace(F fill)
+	{
+		size_t pos = mTail.load(std::memory_order_relaxed);
+
+		for (;;)
+		{
+			Cell* cell = &mCells[pos & (Capacity - 1)];
+			size_t seq = cell->sequence.load(std::memory_order_acquire);
+			ptrdiff_t diff = (ptrdiff_t)seq - (ptrdiff_t)pos;
+
+			if (diff == 0)
+			{
+				if (mTail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				{
+					fill(cell->data);
+					cell->sequence.store(pos + 1, std::memory_order_release);
+					return true;
+				}
+			}
+			else if (diff < 0)
+				return false; // full
+			else
+				pos = mTail.load(std::memory_order_relaxed);
+		}
+	}
+
+	bool TryPush(const T& value)
+	{
+		return TryEmplace([&value](T& slot) { slot = value; });
+	}
+
+	/// Hands the oldest record to consume() and frees its slot. Only one thread may consume.
+	/// Returns false if the ring is empty.
+	template <typename F>
+	bool TryConsume(F consume)
+	{
+		size_t pos = mHead.load(std::memory_order_relaxed);
+		Cell* cell = &mCells[pos & (Capacity - 1)];
+
+		if ((ptrdiff_t)cell->sequence.load(std::memory_order_acquire) - (ptrdiff_t)(pos + 1) < 0)
+			return false; // empty, or the producer has not finished writing yet
+
+		consume(cell->data);
+		mHead.store(pos + 1, std::memory_order_relaxed);
+		cell->sequence.store(pos + Capacity, std::memory_order_release);
+		return true;
+	}
+
+	bool TryPop(T& out)
+	{
+		return TryConsume([&out](T& slot) { out = slot; });
+	}
+
+	bool Empty() const
+	{
+		size_t pos = mHead.load(std::memory_order_relaxed);
+		return (ptrdiff_t)mCells[pos & (Capacity - 1)].sequence.load(std::memory_order_acquire) - (ptrdiff_t)(pos + 1) < 0;
+	}
+
+private:
+	struct Cell
+	{
+		std::atomic<size_t> sequence;
+		T data;
+	};
+
+	// keep the producer and consumer cursors on separate cache lines
+	std::atomic<size_t> mHead;
+	char mPad0[64 - sizeof(std::atomic<size_t>)];
+	std::atomic<size_t> mTail;
+	char mPad1[64 - sizeof(std::atomic<size_t>)];
+	Cell mCells[Capacity];
+};
+
+#endif
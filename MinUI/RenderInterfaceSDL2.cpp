@@ -37,6 +37,8 @@ RocketSDL2Renderer::RocketSDL2Renderer(SDL_Renderer* renderer, SDL_Window* scree
 {
     mRenderer = renderer;
     mScreen = screen;
+    mWidth = 0;
+    mHeight = 0;
 }
 
 // Called by Rocket when it wants to render geometry that it does not wish to optimise.
@@ -111,9 +113,36 @@ void RocketSDL2Renderer::SetScissorRegion(int x, int y, int width, int height)
 {
     int w_width, w_height;
     SDL_GetWindowSize(mScreen, &w_width, &w_height);
+
+    // the region is in Rocket's coordinates, which may be stretched over the window
+    if (mWidth > 0 && mHeight > 0 && (mWidth != w_width || mHeight != w_height))
+    {
+        float sx = (float)w_width / mWidth;
+        float sy = (float)w_height / mHeight;
+        glScissor((int)(x * sx), w_height - (int)((y + height) * sy), (int)(width * sx + 0.5f), (int)(height * sy + 0.5f));
+        return;
+    }
+
     glScissor(x, w_height - (y + height), width, height);
 }
 
+// Sets the viewport to the whole window and the projection to Rocket's coordinates.
+void RocketSDL2Renderer::SetProjection(int width, int height)
+{
+    mWidth = width;
+    mHeight = height;
+
+    int w_width, w_height;
+    SDL_GetWindowSize(mScreen, &w_width, &w_height);
+
+    glViewport(0, 0, w_width, w_height);
+    glMatrixMode(GL_PROJECTION);
+    glLoadIdentity();
+    glOrtho(0, width, height, 0, 0, 1);
+    glMatrixMode(GL_MODELVIEW);
+    glLoadIdentity();
+}
+
 // Called by Rocket when a texture is required by the library.		
 bool RocketSDL2Renderer::LoadTexture(Rocket::Core::TextureHandle& texture_handle, Rocket::Core::Vector2i& texture_dimensions, const Rocket::Core::String& source)
 {
@@ -189,3 +218,27 @@ void RocketSDL2Renderer::ReleaseTexture(Rocket::Core::TextureHandle texture_hand
 {
     SDL_DestroyTexture((SDL_Texture*) texture_handle);
 }
+
+// Creates a texture that is updated in place instead of regenerated.
+Rocket::Core::TextureHandle RocketSDL2Renderer::CreateStreamingTexture(const Rocket::Core::Vector2i& dimensions)
+{
+    // the same byte order GenerateTexture takes: R, G, B, A
+    #if SDL_BYTEORDER == SDL_BIG_ENDIAN
+        Uint32 format = SDL_PIXELFORMAT_RGBA8888;
+    #else
+        Uint32 format = SDL_PIXELFORMAT_ABGR8888;
+    #endif
+
+    SDL_Texture* texture = SDL_CreateTexture(mRenderer, format, SDL_TEXTUREACCESS_STREAMING, dimensions.x, dimensions.y);
+    if (texture)
+        SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+
+    return (Rocket::Core::TextureHandle) texture;
+}
+
+// Uploads part of a streaming texture; the rest of it is left alone.
+bool RocketSDL2Renderer::UpdateTexture(Rocket::Core::TextureHandle texture_handle, int x, int y, int width, int height, const Rocket::Core::byte* pixels, int pitch)
+{
+    SDL_Rect rect = { x, y, width, height };
+    return SDL_UpdateTexture((SDL_Texture*) texture_handle, &rect, pixels, pitch) == 0;
+}
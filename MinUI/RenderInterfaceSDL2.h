@@ -57,9 +57,19 @@ public:
 	/// Called by Rocket when a loaded texture is no longer required.
 	virtual void ReleaseTexture(Rocket::Core::TextureHandle texture_handle);
 
+	/// Creates an RGBA texture meant to be rewritten often, e.g. every frame. Its contents start undefined.
+	Rocket::Core::TextureHandle CreateStreamingTexture(const Rocket::Core::Vector2i& dimensions);
+	/// Uploads a rectangle of RGBA pixels into a streaming texture. pixels points at the rectangle's first pixel; pitch is the source's row length in bytes.
+	bool UpdateTexture(Rocket::Core::TextureHandle texture_handle, int x, int y, int width, int height, const Rocket::Core::byte* pixels, int pitch);
+
+	/// Maps Rocket's width x height coordinates onto the whole window; if the window is another size, they are stretched to fit. Call each frame with the window's GL context current.
+	void SetProjection(int width, int height);
+
 private:
     SDL_Renderer* mRenderer;
     SDL_Window* mScreen;
+    int mWidth;		// Rocket's coordinate space, set by SetProjection(); zero for the window's size
+    int mHeight;
 };
 
 #endif
@@ -27,6 +27,22 @@
 #include <Rocket/Core.h>
 #include "SystemInterfaceSDL2.h"
 
+#include <chrono>
+#include <string.h>
+
+RocketSDL2SystemInterface::RocketSDL2SystemInterface() : mDroppedLogMessages(0), mLogRunning(true), mVirtualTime(false), mVirtualSeconds(0)
+{
+	mLogThread = std::thread(&RocketSDL2SystemInterface::LogThread, this);
+}
+
+RocketSDL2SystemInterface::~RocketSDL2SystemInterface()
+{
+	// the log thread drains whatever is left before it exits
+	mLogRunning = false;
+	if (mLogThread.joinable())
+		mLogThread.join();
+}
+
 Rocket::Core::Input::KeyIdentifier RocketSDL2SystemInterface::TranslateKey(SDL_Keycode sdlkey)
 {
     using namespace Rocket::Core::Input;
@@ -398,14 +414,91 @@ int RocketSDL2SystemInterface::GetKeyModifiers()
 
 float RocketSDL2SystemInterface::GetElapsedTime()
 {
-	return SDL_GetTicks() / 1000;
+	if (mVirtualTime)
+		return (float)mVirtualSeconds;
+
+	return SDL_GetTicks() / 1000.0f;
+}
+
+void RocketSDL2SystemInterface::SetVirtualTime(bool enable)
+{
+	mVirtualTime = enable;
+	mVirtualSeconds = 0;
+}
+
+bool RocketSDL2SystemInterface::IsVirtualTime() const
+{
+	return mVirtualTime;
+}
+
+void RocketSDL2SystemInterface::AdvanceVirtualTime(float seconds)
+{
+	mVirtualSeconds += seconds;
 }
 
 bool RocketSDL2SystemInterface::LogMessage(Rocket::Core::Log::Type type, const Rocket::Core::String& message)
 {
-	std::string Type;
+	if (type > ROCKETSDL2_MIN_LOG_LEVEL)
+		return true;
 
-	switch(type)
+	// copy the message into a preallocated slot; formatting and printing happen on the log thread
+	bool queued = mLogRing.TryEmplace([type, &message](LogRecord& record)
+	{
+		size_t length = message.Length();
+		if (length > ROCKETSDL2_LOG_MESSAGE_SIZE - 1)
+			length = ROCKETSDL2_LOG_MESSAGE_SIZE - 1;
+
+		record.type = type;
+		memcpy(record.message, message.CString(), length);
+		record.message[length] = '\0';
+	});
+
+	if (!queued)
+		mDroppedLogMessages++;
+
+	return true;
+};
+
+unsigned int RocketSDL2SystemInterface::GetDroppedLogMessages() const
+{
+	return mDroppedLogMessages;
+}
+
+void RocketSDL2SystemInterface::LogThread()
+{
+	unsigned int reported_drops = 0;
+
+	for (;;)
+	{
+		// read the flag before draining so nothing queued ahead of shutdown is lost
+		bool running = mLogRunning;
+		bool wrote = false;
+
+		while (mLogRing.TryConsume(WriteLogRecord))
+			wrote = true;
+
+		unsigned int drops = mDroppedLogMessages;
+		if (drops != reported_drops)
+		{
+			printf("[Warning] - %u log message(s) dropped, log ring full\n", drops - reported_drops);
+			reported_drops = drops;
+			wrote = true;
+		}
+
+		if (wrote)
+			fflush(stdout);
+		else if (!running)
+			break;
+		else
+			std::this_thread::sleep_for(std::chrono::milliseconds(2));
+	}
+}
+
+void RocketSDL2SystemInterface::WriteLogRecord(const LogRecord& record)
+{
+	const char* Type = "";
+
+	switch(record.type)
 	{
 	case Rocket::Core::Log::LT_ALWAYS:
 		Type = "[Always]";
@@ -429,10 +522,8 @@ bool RocketSDL2SystemInterface::LogMessage(Rocket::Core::Log::Type type, const R
         break;
 	};
 
-	printf("%s - %s\n", Type.c_str(), message.CString());
-
-	return true;
-};
+	printf("%s - %s\n", Type, record.message);
+}
 
 void RocketSDL2SystemInterface::ActivateKeyboard()
 {
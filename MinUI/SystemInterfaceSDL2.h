@@ -32,9 +32,29 @@
 
 #include <SDL.h>
 
+#include <atomic>
+#include <thread>
+#include "MPSCRingBuffer.h"
+
+// Messages less severe than this are discarded before they are queued.
+// Debug logging is compiled out of release builds unless overridden.
+#ifndef ROCKETSDL2_MIN_LOG_LEVEL
+#ifdef NDEBUG
+#define ROCKETSDL2_MIN_LOG_LEVEL Rocket::Core::Log::LT_INFO
+#else
+#define ROCKETSDL2_MIN_LOG_LEVEL Rocket::Core::Log::LT_DEBUG
+#endif
+#endif
+
+#define ROCKETSDL2_LOG_RING_SIZE	1024
+#define ROCKETSDL2_LOG_MESSAGE_SIZE	240
+
 class RocketSDL2SystemInterface : public Rocket::Core::SystemInterface
 {
 public:
+	RocketSDL2SystemInterface();
+	virtual ~RocketSDL2SystemInterface();
+
     Rocket::Core::Input::KeyIdentifier TranslateKey(SDL_Keycode sdlkey);
     int TranslateMouseButton(Uint8 button);
 	int GetKeyModifiers();
@@ -42,5 +62,32 @@ public:
     bool LogMessage(Rocket::Core::Log::Type type, const Rocket::Core::String& message);
 	void ActivateKeyboard();
 	void DeactivateKeyboard();
+
+	/// Number of log messages discarded because the ring was full.
+	unsigned int GetDroppedLogMessages() const;
+
+	/// Switches GetElapsedTime() between the wall clock and a virtual clock that only moves when advanced.
+	void SetVirtualTime(bool enable);
+	bool IsVirtualTime() const;
+	/// Moves the virtual clock forward.
+	void AdvanceVirtualTime(float seconds);
+
+private:
+	struct LogRecord
+	{
+		Rocket::Core::Log::Type type;
+		char message[ROCKETSDL2_LOG_MESSAGE_SIZE];
+	};
+
+	void LogThread();
+	static void WriteLogRecord(const LogRecord& record);
+
+	MPSCRingBuffer<LogRecord, ROCKETSDL2_LOG_RING_SIZE> mLogRing;
+	std::atomic<unsigned int> mDroppedLogMessages;
+	std::atomic<bool> mLogRunning;
+	std::thread mLogThread;
+
+	bool mVirtualTime;
+	double mVirtualSeconds;
 };
 #endif
@@ -0,0 +1,175 @@
+/**
+ * MinGUI
+ * Released under the MIT license, (c) Neil Rao
+ */
+
+#include "TaskPool.h"
+
+#include <algorithm>
+
+TaskPool::TaskPool(int threads) : mNextWorker(0), mQueued(0), mRunning(true), mHasOverflow(false), mNextTicket(0), mNextToRun(0)
+{
+	if (threads <= 0)
+	{
+		int cores = (int)std::thread::hardware_concurrency();
+		threads = cores > 1 ? cores - 1 : 1;
+	}
+
+	// every worker exists before any of them starts stealing
+	for (int i = 0; i < threads; i++)
+		mWorkers.push_back(new Worker());
+
+	for (size_t i = 0; i < mWorkers.size(); i++)
+		mWorkers[i]->thread = std::thread(&TaskPool::WorkerLoop, this, i);
+}
+
+TaskPool::~TaskPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mWakeMutex);
+		mRunning = false;
+	}
+	mWake.notify_all();
+
+	for (size_t i = 0; i < mWorkers.size(); i++)
+	{
+		mWorkers[i]->thread.join();
+		delete mWorkers[i];
+	}
+}
+
+void TaskPool::Submit(Function task, Function done, void* userdata)
+{
+	Task t = { task, done, userdata, 0 };
+
+	// counted before it is queued, so a worker that sees nothing queued can sleep safely
+	mQueued++;
+
+	Worker* worker = mWorkers[mNextWorker++ % mWorkers.size()];
+	{
+		std::lock_guard<std::mutex> lock(worker->mutex);
+		worker->tasks.push_back(t);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mWakeMutex);
+	}
+	mWake.notify_one();
+}
+
+bool TaskPool::Take(size_t index, Task& task)
+{
+	{
+		Worker* own = mWorkers[index];
+		std::lock_guard<std::mutex> lock(own->mutex);
+		if (!own->tasks.empty())
+		{
+			task = own->tasks.front();
+			own->tasks.pop_front();
+			return true;
+		}
+	}
+
+	for (size_t i = 1; i < mWorkers.size(); i++)
+	{
+		Worker* victim = mWorkers[(index + i) % mWorkers.size()];
+		std::lock_guard<std::mutex> lock(victim->mutex);
+		if (!victim->tasks.empty())
+		{
+			task = victim->tasks.back();
+			victim->tasks.pop_back();
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void TaskPool::WorkerLoop(size_t index)
+{
+	for (;;)
+	{
+		// stopping drops whatever is still queued
+		if (!mRunning)
+			return;
+
+		Task task;
+		if (Take(index, task))
+		{
+			mQueued--;
+
+			if (task.task != NULL)
+				task.task(task.userdata);
+
+			Complete(task);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(mWakeMutex);
+		mWake.wait(lock, [this] { return mQueued > 0 || !mRunning; });
+
+		if (!mRunning)
+			return;
+	}
+}
+
+void TaskPool::Complete(const Task& task)
+{
+	if (task.done == NULL)
+		return;
+
+	// the ticket fixes the order the done functions run in, whichever way
+	// the completion reaches the UI thread
+	Task t = task;
+	t.ticket = mNextTicket++;
+
+	if (mCompleted.TryPush(t))
+		return;
+
+	// the UI thread is behind; don't block the worker on it
+	std::lock_guard<std::mutex> lock(mOverflowMutex);
+	mOverflow.push_back(t);
+	mHasOverflow = true;
+}
+
+int TaskPool::RunCompletions(int max)
+{
+	Task task;
+
+	// a worker whose push found the ring full can lose the race to a later
+	// completion pushed once the ring has room again, so collect both queues
+	// and go by ticket
+	while (mCompleted.TryPop(task))
+	{
+		mReady.push_back(task);
+		std::push_heap(mReady.begin(), mReady.end(), LaterTicket());
+	}
+
+	if (mHasOverflow)
+	{
+		std::lock_guard<std::mutex> lock(mOverflowMutex);
+		for (size_t i = 0; i < mOverflow.size(); i++)
+		{
+			mReady.push_back(mOverflow[i]);
+			std::push_heap(mReady.begin(), mReady.end(), LaterTicket());
+		}
+		mOverflow.clear();
+		mHasOverflow = false;
+	}
+
+	// stop at a gap; the missing completion is still on its way
+	int ran = 0;
+	while ((max <= 0 || ran < max) && !mReady.empty() && mReady.front().ticket == mNextToRun)
+	{
+		std::pop_heap(mReady.begin(), mReady.end(), LaterTicket());
+		task = mReady.back();
+		mReady.pop_back();
+		mNextToRun++;
+
+		// done functions may submit more tasks
+		task.done(task.userdata);
+		ran++;
+	}
+
+	return ran;
+}
@@ -0,0 +1,93 @@
+/**
+ * MinGUI
+ * Released under the MIT license, (c) Neil Rao
+ */
+
+#ifndef TASKPOOL_H
+#define TASKPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "MPSCRingBuffer.h"
+
+#define TASKPOOL_COMPLETION_RING_SIZE	1024
+
+/**
+ * Worker threads that run tasks off the UI thread. Each worker has its own
+ * queue; submissions are spread over the queues round robin, and a worker
+ * whose queue is empty steals from the back of the others' before it sleeps.
+ *
+ * When a task finishes, its done function is not called on the worker but
+ * queued, and the UI thread runs it from RunCompletions(), so done functions
+ * can touch widgets.
+ */
+class TaskPool
+{
+public:
+	typedef void (*Function)(void* userdata);
+
+	/// Starts the workers; zero threads means one per core, less the UI thread's.
+	TaskPool(int threads = 0);
+	/// Waits for running tasks. Queued tasks and pending completions are dropped.
+	~TaskPool();
+
+	/// Queues task to run on a worker, then done on the thread calling RunCompletions(). Either may be NULL.
+	void Submit(Function task, Function done, void* userdata);
+
+	/// Runs the done functions of up to max finished tasks, in the order they finished; zero or less means all. Returns how many ran.
+	/// A completion waits for any that finished before it but are still being handed over.
+	int RunCompletions(int max);
+
+	int GetThreadCount() const { return (int)mWorkers.size(); }
+
+private:
+	struct Task
+	{
+		Function task;
+		Function done;
+		void* userdata;
+		unsigned int ticket;	// when it finished, relative to the others
+	};
+
+	// orders the ready heap so the earliest ticket is on top
+	struct LaterTicket
+	{
+		bool operator()(const Task& a, const Task& b) const { return (int)(a.ticket - b.ticket) > 0; }
+	};
+
+	struct Worker
+	{
+		std::mutex mutex;
+		std::deque<Task> tasks;	// the owner takes from the front, thieves from the back
+		std::thread thread;
+	};
+
+	void WorkerLoop(size_t index);
+	bool Take(size_t index, Task& task);
+	void Complete(const Task& task);
+
+	std::vector<Worker*> mWorkers;
+	std::atomic<unsigned int> mNextWorker;
+	std::atomic<int> mQueued;
+	std::atomic<bool> mRunning;
+
+	std::mutex mWakeMutex;
+	std::condition_variable mWake;
+
+	// finished tasks, for the UI thread; the overflow takes what doesn't fit in the ring
+	MPSCRingBuffer<Task, TASKPOOL_COMPLETION_RING_SIZE> mCompleted;
+	std::mutex mOverflowMutex;
+	std::vector<Task> mOverflow;
+	std::atomic<bool> mHasOverflow;
+	std::atomic<unsigned int> mNextTicket;
+
+	// UI thread only: collected completions, and the ticket that runs next
+	std::vector<Task> mReady;
+	unsigned int mNextToRun;
+};
+
+#endif
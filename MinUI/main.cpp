@@ -23,6 +23,7 @@ THE SOFTWARE.
 */
 
 #include "mingui.h"
+#include "mingui_ui.h"
 
 #include <iostream>
 #include <ctime>
@@ -64,6 +65,7 @@ char dest_letter;
 int origin_robot;
 char** buffer;
 square_t** board;
+int robot_home[MAX_ROBOTS + 1][2]; // buffer row/column each robot was laid out at
 
 
 // This function is called when the exit game button is clicked.
@@ -91,7 +93,7 @@ void selectRobot(int id)
 
 			// If the robot image is valid
 			if (robot)
-				set_border(robot, "white", id == i ? 2 : 0); // put a border around it
+				set_border(robot, "white", id == i ? 2 : 0); // put a border around it; it's redrawn next frame
 		}
 	}
 }
@@ -110,7 +112,6 @@ int onRobotClicked(const char* event, Widget robotContainer, WidgetEvent e)
 	cur_robot = id[0] - '0';
 
 	selectRobot(cur_robot);
-	widget_refresh_all();
 
 	return 0; // don't allow the click to continue further
 }
@@ -310,6 +311,13 @@ void load_board(char** board_o, int size_x, int size_y, const int ox, const int
 	// account for walls and padding
 	calc_board_display_sizes(size_x, size_y);
 
+	// build everything detached and lay the document out once at the end
+	batch_scope batch;
+
+	// all the walls go into one tile map; brick.png is a single 64x64 tile
+	Widget walls = create_tilemap(size_x, size_y, squareSideLength, squareSideLength, "brick.png", 64, 64);
+	set_position(walls, ox, oy);
+
 	// draw each line
 	for (int i = 0; i < size_y; i++)
 	{
@@ -317,10 +325,7 @@ void load_board(char** board_o, int size_x, int size_y, const int ox, const int
 		{
 			if (board_o[i][j] == WALLVERT || board_o[i][j] == WALLHORIZ || i == 0 || i == size_y - 1)
 			{
-				Widget wall = create_image("brick.png");
-				set_width(wall, squareSideLength);
-				set_height(wall, squareSideLength);
-				set_position(wall, ox + j * squareSideLength, oy + i * squareSideLength);
+				set_tile(walls, j, i, 0);
 			}
 			else if (board_o[i][j] >= 'A' && board_o[i][j] <= 'Z')
 			{
@@ -352,7 +357,7 @@ void load_board(char** board_o, int size_x, int size_y, const int ox, const int
 				// Style the text and container
 				set_text(robotContainer, id);
 				set_attribute(robotContainer, "id", id); // set the robot's id and name
-				set_attribute(robotContainer, "class", id);
+				set_attribute(robotContainer, "class", Rocket::Core::String(32, "%s robot", id).CString());
 
 				set_text_color(robotContainer, "white");
 				set_text_size(robotContainer, 22);
@@ -362,6 +367,10 @@ void load_board(char** board_o, int size_x, int size_y, const int ox, const int
 				set_height(robotContainer, squareSideLength + 10);
 				set_position(robotContainer, ox + j * squareSideLength, oy + i * squareSideLength - IdOffset);
 
+				// robots move by translation from here, so remember where that is
+				robot_home[board_o[i][j] - '0'][0] = i;
+				robot_home[board_o[i][j] - '0'][1] = j;
+
 				// Create the robot image and attach it
 				Widget robot = create_image("robot.png");
 				set_width(robot, squareSideLength);
@@ -369,9 +378,6 @@ void load_board(char** board_o, int size_x, int size_y, const int ox, const int
 				set_position(robot, 0, 0);
 				set_attribute(robot, "class", id);
 				attach(robot, robotContainer);
-
-				// bind it to the click handler
-				bind_event(robotContainer, "click", onRobotClicked);
 			}
 		}
 	}
@@ -522,25 +528,6 @@ char** parse_data(const char* filename, square_t** board, int size_x, int& maxro
 	return lines;
 }
 
-// returns a value depending on key press
-KBKEY get_arrow_key()
-{
-	const Uint8 *state = SDL_GetKeyboardState(NULL);
-	
-	if (state[SDL_SCANCODE_RIGHT])
-		return KBRIGHT;
-	else if (state[SDL_SCANCODE_UP])
-		return KBUP;
-	else if (state[SDL_SCANCODE_DOWN])
-		return KBDOWN;
-	else if (state[SDL_SCANCODE_LEFT])
-		return KBLEFT;
-	else if (state[SDL_SCANCODE_ESCAPE])
-		return KBESC;
-
-	return KBOTH;
-}
-
 // finds the specified robot
 square_t* find_robot(int robot, square_t** board, const int size_x, const int size_y, int& posx, int& posy)
 {
@@ -652,52 +639,94 @@ POSINFO move_robot(int robot, KBKEY direction, square_t** board, const int size_
 }
 
 
-// This function is called every frame. When 0 is returned, the game exits.
-int my_game()
+// This function is called when an arrow key is pressed. Holding the key down
+// doesn't call it again, so the game only does work when there's input.
+void onArrowKey(SDL_Keycode key, bool /* repeat */)
 {
-	// get key
-	KBKEY k = get_arrow_key();
+	KBKEY k = key == SDLK_UP ? KBUP : key == SDLK_DOWN ? KBDOWN : key == SDLK_LEFT ? KBLEFT : KBRIGHT;
 
-	// process input
-	switch (k)
-	{
-	case KBUP:
-	case KBDOWN:
-	case KBLEFT:
-	case KBRIGHT:
+	if (move_robot(cur_robot, k, board, board_size, board_size, dest_letter, origin_robot) == WIN)
 	{
-		if (move_robot(cur_robot, k, board, board_size, board_size, dest_letter, origin_robot) == WIN)
-			return 0;
+		exit_game();
+		return;
+	}
 
-		// write to buffer
-		write_board(board, buffer, board_size, board_size);
+	// write to buffer
+	write_board(board, buffer, board_size, board_size);
 
-		// find the widget
-		char rc = '0' + cur_robot;
-		char id[] = { rc, 0 };
-		Widget robot = get_widget_by_id(id);
+	// find the widget
+	char rc = '0' + cur_robot;
+	char id[] = { rc, 0 };
+	Widget robot = get_widget_by_id(id);
 
-		// find the robot in the buffer
-		int x = board_size, y = board_size;
-		calc_board_display_sizes(x, y);
+	// find the robot in the buffer
+	int x = board_size, y = board_size;
+	calc_board_display_sizes(x, y);
 
-		for (int i = 0; i < y; i++)
-			for (int j = 0; j < x; j++)
+	for (int i = 0; i < y; i++)
+		for (int j = 0; j < x; j++)
+		{
+			if (buffer[i][j] == rc)
 			{
-				if (buffer[i][j] == rc)
-				{
-					set_position(robot, ox + j * squareSideLength, oy + i * squareSideLength - IdOffset);
-					return 1;
-				}
+				// slide it over from where it was laid out; this doesn't cause a relayout
+				animate_translation(robot, (float)(j - robot_home[cur_robot][1]) * squareSideLength, (float)(i - robot_home[cur_robot][0]) * squareSideLength, 150, EASE_OUT);
+				return;
 			}
+		}
+}
+
+
+// "--benchmark-hud": a block of numbers that all change every frame
+const int hud_count = 100;
+Widget hud[hud_count];
+int hud_updates = 0;
+
+void updateHud()
+{
+	int frame = get_frame_count();
+	for (int i = 0; i < hud_count; i++)
+		set_text(hud[i], Rocket::Core::String(16, "%d", frame * 7 + i).CString());
+
+	hud_updates += hud_count;
+}
+
 
-		break;
+// "--benchmark-tweens": a thousand boxes sliding about at once
+const int tween_count = 1000;
+const int benchmark_frames = 600;
+bool tween_benchmark = false;
+
+void startTweens()
+{
+	for (int i = 0; i < tween_count; i++)
+	{
+		Widget box = create_container();
+		set_width(box, 4);
+		set_height(box, 4);
+		set_background_color(box, "#FFCC00");
+		set_position(box, 620 + (i % 40) * 9, 300 + (i / 40) * 9);
+
+		// long enough to still be running when the benchmark ends
+		animate_translation(box, (float)(rand() % 200 - 100), (float)(rand() % 200 - 100), 20000, EASE_IN_OUT);
 	}
+}
+
+
+// This function is called every frame. When 0 is returned, the game exits.
+int my_game()
+{
+	if (hud[0] != NULL)
+		updateHud();
 
-	default:
-		break;
+	if (tween_benchmark && get_frame_count() == benchmark_frames - 1)
+	{
+		int active;
+		float ms;
+		get_tween_stats(&active, &ms);
+		std::cout << "tweens: " << active << " running, " << ms * 1000.0f << " us per frame per thousand" << std::endl;
 	}
 
+	// everything else happens in the event handlers
 	return 1;
 }
 
@@ -705,6 +734,17 @@ int my_game()
 // starting point
 int main(int argc, char **argv)
 {
+	// "--benchmark" times board construction and runs a fixed number of frames
+	// on a virtual clock so timings can be compared between builds
+	bool benchmark = argc > 1 && !strcmp(argv[1], "--benchmark");
+
+	// "--benchmark-hud" does the same while changing 100 numbers every frame,
+	// to time set_text (build with MINGUI_REPARSE_TEXT to compare)
+	bool benchmark_hud = argc > 1 && !strcmp(argv[1], "--benchmark-hud");
+
+	// "--benchmark-tweens" does the same while a thousand animations run
+	tween_benchmark = argc > 1 && !strcmp(argv[1], "--benchmark-tweens");
+
 	// initialize the game window
 	create_window("Program 3", 1024, 768);
 
@@ -720,53 +760,30 @@ int main(int argc, char **argv)
 	// Let's add some title text
 	//////////////////////////////////////////////////////////////////
 
-	// add some text
-	Widget titleText = create_text("Program 3: Robots");
-
-	// set the font by its name
-	set_font(titleText, "Classic Robot");
-
-	// Make it bold and italic
-	set_text_style(titleText, FONT_BOLD_AND_ITALIC);
-
-	// Make it big (imagine using a word processor)
-	set_text_size(titleText, 28);
-
-	// Now position it on the screen
-	set_position(titleText, 400, 30);
-
-	// Now set the text box's width. This is different from set_text_size().
-	// A word processor analogy: imagine that you create a text box in Word
-	// with some text in it. Above, set_text_size() will change the font size,
-	// while set_width() below will resize the text box itself. In other words,
-	// you change the width and height of the text box to word wrap the text.
-	set_width(titleText, 400);
-
-	// Make the text color white
-	set_text_color(titleText, "white");
+	// Static parts of the screen can be described in one go. Each ui:: modifier
+	// is checked when the program compiles and costs nothing to parse at runtime.
+	// Modifiers do what their set_* counterparts do, e.g. ui::pos<400, 30>() is
+	// set_position(w, 400, 30) and ui::size<28>() is set_text_size(w, 28).
+	// Colours are written as 0xRRGGBBAA.
+	ui::build(ui::text("Program 3: Robots",
+		ui::font("Classic Robot"),					// the font, by its name
+		ui::style<FONT_BOLD_AND_ITALIC>(),			// bold and italic
+		ui::size<28>(),								// big (imagine using a word processor)
+		ui::pos<400, 30>(),							// where it goes on the screen
+		ui::width<400>(),							// the text box's width; text wraps inside it
+		ui::color<0xFFFFFFFF>()));					// white
 
 
 	//////////////////////////////////////////////////////////////////
 	// Let's add an exit button
 	//////////////////////////////////////////////////////////////////
 
-	Widget exitButton = create_button("X (Exit)");
-
-	// Set its width/height
-	set_width(exitButton, 70);
-	set_height(exitButton, 20);
-
-	// Now position it on the screen
-	set_position(exitButton, 14, 30);
-
-	// Set the background color
-	set_background_color(exitButton, "red");
-
-	// Set the text color
-	set_text_color(exitButton, "white");
-
-	// Center the text inside
-	set_text_center(exitButton);
+	Widget exitButton = ui::build(ui::button("X (Exit)",
+		ui::width<70>(), ui::height<20>(),
+		ui::pos<14, 30>(),
+		ui::background<0xFF0000FF>(),				// red
+		ui::color<0xFFFFFFFF>(),					// white text
+		ui::center()));								// centered inside
 
 	// Now we will bind the onExitButtonClicked function to the button's "click" event
 	bind_event(exitButton, "click", onExitButtonClicked);
@@ -829,9 +846,33 @@ int main(int argc, char **argv)
 	// Load the walls and other info
 	//////////////////////////////////////////////////////////////////
 
+	// the arrow keys move the selected robot
+	bind_key(SDLK_UP, onArrowKey);
+	bind_key(SDLK_DOWN, onArrowKey);
+	bind_key(SDLK_LEFT, onArrowKey);
+	bind_key(SDLK_RIGHT, onArrowKey);
+
+	// one click handler for every robot: clicks anywhere in the window are
+	// passed to onRobotClicked if they land inside something with the "robot" class
+	delegate_event(get_root(), "click", ".robot", onRobotClicked);
+
 	// loop through the board and add the walls
+	Uint64 load_start = SDL_GetPerformanceCounter();
 	load_board(buffer, board_size, board_size, ox, oy, squareSideLength);
 
+	if (benchmark)
+	{
+		std::cout << "load_board: " << (SDL_GetPerformanceCounter() - load_start) * 1000.0 / SDL_GetPerformanceFrequency() << " ms" << std::endl;
+
+		// elements styled alike share generated classes instead of each holding the properties inline
+		int classes, elements, properties;
+		get_style_stats(&classes, &elements, &properties);
+		std::cout << "style classes: " << classes << ", elements using them: " << elements << ", inline properties saved: " << properties;
+		if (elements > 0)
+			std::cout << " (" << (float)properties / elements << " per element, ~" << properties * sizeof(Rocket::Core::Property) / elements << " bytes of property values)";
+		std::cout << std::endl;
+	}
+
 	// select the default robot
 	selectRobot(cur_robot);
 
@@ -843,13 +884,37 @@ int main(int argc, char **argv)
 	set_position(robotInfo, 400, 80);
 
 
+	if (benchmark_hud)
+	{
+		for (int i = 0; i < hud_count; i++)
+		{
+			hud[i] = create_text("0");
+			set_text_color(hud[i], "white");
+			set_position(hud[i], 620 + (i % 10) * 40, 400 + (i / 10) * 24);
+		}
+	}
+
+
 	//////////////////////////////////////////////////////////////////
 	// Let's start the game
 	//////////////////////////////////////////////////////////////////
 
+	if (tween_benchmark)
+		startTweens();
+
+	if (benchmark || benchmark_hud || tween_benchmark)
+		set_virtual_time(1000.0f / 60, benchmark_frames);
+
 	// start the game
+	Uint64 game_start = SDL_GetPerformanceCounter();
 	StartGame(my_game);
 
+	if (benchmark_hud)
+	{
+		double seconds = (double)(SDL_GetPerformanceCounter() - game_start) / SDL_GetPerformanceFrequency();
+		std::cout << "hud: " << hud_updates << " text updates in " << seconds * 1000.0 << " ms, " << (int)(hud_updates / seconds) << " updates/s" << std::endl;
+	}
+
 	// cleanup
 	free_board(board, board_size);
 	free_board_display(buffer, board_size);
@@ -11,13 +11,34 @@
 
 #include <Rocket/Core.h>
 #include <Rocket/Core/Input.h>
+#include <Rocket/Core/StyleSheetKeywords.h>
+#include <Rocket/Core/ElementInstancerGeneric.h>
+#include <Rocket/Core/GeometryUtilities.h>
+#include <Rocket/Core/FontDatabase.h>
+#include <Rocket/Core/StyleSheetSpecification.h>
+#include <Rocket/Core/PropertyDictionary.h>
+#include <Rocket/Core/PropertyDefinition.h>
 #include <Rocket/Debugger/Debugger.h>
 #include <Rocket/Controls.h>
 #include "SystemInterfaceSDL2.h"
 #include "RenderInterfaceSDL2.h"
+#include "ElementTileMap.h"
+#include "ElementCanvas.h"
+#include "ElementSprite.h"
+#include "ElementVirtualList.h"
+#include "DocumentCache.h"
+#include "TaskPool.h"
+#include "MPSCRingBuffer.h"
 #include <SDL.h>
 #include <GL/glew.h>
 #include <string.h>
+#include <vector>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <atomic>
 
 // basic config
 #define DEFAULT_FONT	"Lacuna"
@@ -29,37 +50,289 @@
 #define FONT_ITALIC				(1 << 1)
 #define FONT_BOLD_AND_ITALIC	(FONT_BOLD | FONT_ITALIC)
 
+// what invalidate() marks dirty
+#define INVALIDATE_STYLE		(1 << 0)
+#define INVALIDATE_LAYOUT		(1 << 1)
+#define INVALIDATE_GEOMETRY		(1 << 2)
+#define INVALIDATE_ALL			(INVALIDATE_STYLE | INVALIDATE_LAYOUT | INVALIDATE_GEOMETRY)
+
+// bind_key() repeat modes; a positive value is a repeat interval in ms
+#define KEY_NO_REPEAT			(-1)	// only the initial press
+#define KEY_OS_REPEAT			0		// the operating system's key repeat
+
+// set_async_completions_per_frame()
+#define ASYNC_COMPLETIONS_DEFAULT	32		// done callbacks run per frame unless set otherwise
+#define ASYNC_UNLIMITED				(-1)
+
+// animate() properties
+#define ANIM_TRANSLATION		0		// animate_translation()
+#define ANIM_OPACITY			1
+#define ANIM_SCALE				2		// sprites only
+#define ANIM_COLOR				3		// animate_color()
+
+// animate() easing curves
+#define EASE_LINEAR				0
+#define EASE_IN					1		// starts slow
+#define EASE_OUT				2		// ends slow
+#define EASE_IN_OUT				3
+
+// post_set_* queue (widget changes from other threads)
+#ifndef MINGUI_POST_RING_SIZE
+#define MINGUI_POST_RING_SIZE		4096
+#endif
+#define MINGUI_POST_ID_SIZE			64		// longer ids are cut short
+#define MINGUI_POST_TEXT_SIZE		184		// longer text is cut short
 
-// engine state is global
-struct enstate
+
+// a property write deferred until the current batch is committed
+struct _staged_property
+{
+	Rocket::Core::Element* w;
+	Rocket::Core::String name;
+	Rocket::Core::String value; // unparsed value, if parsed is false
+	Rocket::Core::Property property;
+	bool parsed;
+};
+
+// a render-time offset for a widget (set_translation)
+struct _translation
+{
+	Rocket::Core::Element* w;
+	Rocket::Core::Vector2f offset;		// requested translation
+	Rocket::Core::Vector2f layout;		// border box offset the last layout gave the widget
+	Rocket::Core::Vector2f base;		// what layout passed to SetOffset(); layout less margin and positioning
+	Rocket::Core::Vector2f applied;		// border box offset after we last moved the widget
+	bool placed;						// applied is valid
+	bool dirty;
+};
+
+// what the id/class index holds for one element
+struct _indexed
+{
+	std::string id;
+	std::vector<std::string> classes;
+};
+
+// callbacks for one key (bind_key)
+struct _key_binding
+{
+	SDL_Keycode key;
+	void(*on_down)(SDL_Keycode, bool);
+	void(*on_up)(SDL_Keycode, bool);
+	int repeat_ms;
+	bool held;
+	float next_repeat;	// elapsed time of the next synthesized repeat
+};
+
+// a widget's text or property bound to a variable (bind_text/bind_prop)
+struct _binding
+{
+	Rocket::Core::Element* w;
+	const void* value;
+	int type;							// BIND_INT, BIND_FLOAT or BIND_STRING
+	std::string snapshot;				// the value's bytes when it was last applied
+	std::string format;					// text bindings
+	Rocket::Core::String property;		// property bindings; empty for text
+	Rocket::Core::Property::Unit unit;
+};
+
+// one running animation (animate); values are (x, y) for translations, (r, g, b, a) for colours
+struct _tween
+{
+	Rocket::Core::Element* w;
+	int property;
+	int easing;
+	float start;		// elapsed time it started
+	float duration;		// seconds
+	float from[4];
+	float to[4];
+};
+
+// a widget change posted from another thread (post_set_text etc.)
+struct _posted
+{
+	int op;							// POST_TEXT, POST_POSITION or POST_TRANSLATION
+	char id[MINGUI_POST_ID_SIZE];
+	char text[MINGUI_POST_TEXT_SIZE];
+	float x, y;
+};
+
+// one immediate-mode primitive; its vertices and indices live in the window's draw buffers
+struct _draw_primitive
+{
+	int layer;
+	Rocket::Core::TextureHandle texture;
+	size_t order;				// submission order, to keep the sort stable
+	unsigned int first_vertex;
+	unsigned int num_vertices;
+	unsigned int first_index;
+	unsigned int num_indices;	// indices are relative to first_vertex
+};
+
+// state of one window: its SDL window and renderer, Rocket context and document
+struct winstate
 {
 	Rocket::Core::Context* context;
 	Rocket::Core::ElementDocument* document;
-	int window_width;
+	int window_width;		// the context's size; the window is stretched to it until a resize is applied
 	int window_height;
 	int clear_r;
 	int clear_g;
 	int clear_b;
 	std::string title;
 	SDL_Window* screen;
+	SDL_GLContext glcontext;
 	SDL_Renderer* renderer;
 	RENDERER* rrenderer;
+	Uint32 window_id;
+	bool closed;
+
+	// the last size the window was given, until the context follows it (see _apply_resize)
+	bool resize_pending;
+	int pending_width;
+	int pending_height;
+	Uint32 resize_ticks;	// when that size arrived
+
+	// batched construction (begin_batch/end_batch)
+	int batch_depth;
+	std::vector<struct _staged_property> batch_properties;
+	std::vector<std::pair<Rocket::Core::Element*, Rocket::Core::Element*> > batch_attachments; // (child, parent or NULL for the document)
+
+	// render-time offsets, and where each widget's is in translations
+	std::vector<_translation> translations;
+	std::unordered_map<Rocket::Core::Element*, size_t> translation_slots;
+
+	// running animations, advanced once per frame in one pass
+	std::vector<_tween> tweens;
+	Uint64 tween_ticks;		// time spent advancing them, for get_tween_stats()
+	int tween_frames;
+	int tween_count;		// summed over frames
+
+	// bound values, checked once per frame
+	std::vector<_binding> bindings;
+
+	// explicit invalidation (invalidate/flush_updates)
+	std::vector<std::pair<Rocket::Core::Element*, int> > dirty_widgets;
+
+	// id and class index
+	std::unordered_map<std::string, Rocket::Core::Element*> id_index;
+	std::unordered_map<std::string, std::vector<Rocket::Core::Element*> > class_index;
+	std::unordered_map<Rocket::Core::Element*, _indexed> indexed;
+	std::unordered_set<std::string> id_misses;	// ids get_widget_by_id() found nowhere
+
+	// generated style classes, by the rcss of the properties they hold
+	std::unordered_map<std::string, std::string> style_classes;
+
+	// destroyed elements kept for reuse by create(), by tag, and unparented ones (new or detached) kept alive
+	std::unordered_map<std::string, std::vector<Rocket::Core::Element*> > pools;
+	std::unordered_set<Rocket::Core::Element*> detached;
+
+	// immediate-mode drawing (draw_rect/draw_image/draw_text), recorded for the next frame
+	std::vector<_draw_primitive> draw_primitives;
+	std::vector<Rocket::Core::Vertex> draw_vertices;
+	std::vector<int> draw_indices;
+	std::vector<Rocket::Core::Vertex> draw_batch_vertices;	// merged per draw call while rendering
+	std::vector<int> draw_batch_indices;
+	std::unordered_map<std::string, Rocket::Core::Texture*> draw_textures;
+	std::unordered_map<std::string, Rocket::Core::FontFaceHandle*> draw_fonts;
+};
+
+// engine state is per process; everything that belongs to a window is in its winstate
+struct enstate
+{
 	SYSTEMINTERFACE* rsi;
 	bool exit;
-} static _enstate{0};
 
-static inline struct enstate* GetEngineState()
+	// every open window, in creation order; widgets are created in the current one
+	std::vector<struct winstate*> windows;
+	struct winstate* current;
+	int last_flush_touched;
+
+	// style interning (see end_batch)
+	int style_classes_created;
+	int style_elements_interned;
+	int style_properties_interned;
+
+	// binding updates (see _apply_bindings)
+	int bindings_applied;
+	int bindings_skipped;
+
+	// keyboard callbacks
+	std::vector<_key_binding> key_bindings;
+
+	// background tasks (run_async); the pool starts with the first task
+	TaskPool* tasks;
+	int async_completions_per_frame; // 0 for ASYNC_COMPLETIONS_DEFAULT
+
+	// resizing waits for the window to stop changing size for this long (set_resize_debounce)
+	int resize_debounce_ms;
+
+	// widget changes posted from other threads, drained once per frame
+	MPSCRingBuffer<_posted, MINGUI_POST_RING_SIZE> posts;
+	std::vector<_posted> posts_pending;						// this frame's, one per widget and operation
+	std::unordered_map<std::string, size_t> posts_latest;	// (id, operation) -> index in posts_pending
+	std::atomic<int> posts_dropped;
+	int posts_applied;
+	int posts_coalesced;
+
+	// virtual time (reproducible benchmark runs)
+	bool virtual_time;
+	float frame_delta;
+	int max_frames;
+	int frame;
+	std::vector<std::pair<int, SDL_Event> > injected_events;
+	size_t next_injected_event;
+};
+
+// a function-local static in an inline function is one object program-wide,
+// where a static at namespace scope would be one per translation unit
+inline struct enstate* GetEngineState()
 {
+	static struct enstate _enstate{};
 	return &_enstate;
 }
 
+/**
+ * The window new widgets go into: the last one created or passed to
+ * set_current_window(), or the one whose events are being processed.
+ */
+inline struct winstate* GetWindowState()
+{
+	return GetEngineState()->current;
+}
+
+/**
+ * The window an element belongs to.
+ */
+static struct winstate* _window_of(Rocket::Core::Element* w)
+{
+	struct enstate* enstate = GetEngineState();
+	Rocket::Core::ElementDocument* document = w->GetOwnerDocument();
+
+	for (size_t i = 0; i < enstate->windows.size(); i++)
+		if (enstate->windows[i]->document == document)
+			return enstate->windows[i];
+
+	return enstate->current;
+}
+
 // nomenclature
 typedef Rocket::Core::Element* Widget;
+typedef struct winstate* Window;
 typedef Rocket::Core::Event& WidgetEvent;
 
 // function ptr for events
 typedef int(*basic_event_ptr)(const char*, Widget, WidgetEvent);
 
+// function ptr for key callbacks; repeat is true for repeats of a held key
+typedef void(*key_event_ptr)(SDL_Keycode key, bool repeat);
+
+// function ptr that fills a row of a virtual list
+typedef void(*list_fill_ptr)(Widget row, int index);
+
+// function ptrs for background tasks and their completions
+typedef void(*task_fn_ptr)(void* userdata);
+
 // fnctn ptr to game loop
 typedef int(*game_loop_ptr)();
 
@@ -84,560 +357,3400 @@ namespace Rocket
 }
 #endif
 
-// for event handling
+// for event handling. There is one listener per handler function, shared by
+// every element it is bound to; it deletes itself once no element uses it.
 class _Listener : public Rocket::Core::EventListener
 {
 private:
 	basic_event_ptr ev;
+	int attachments;
+	std::multimap<Rocket::Core::Element*, Rocket::Core::String> bound; // (element, event type) per attachment
+
+	_Listener(basic_event_ptr e) : ev(e), attachments(0) {}
+
+	static std::map<basic_event_ptr, _Listener*>& interned()
+	{
+		static std::map<basic_event_ptr, _Listener*> listeners;
+		return listeners;
+	}
+
 public:
-	_Listener(basic_event_ptr e) : ev(e) {}
+	static _Listener* Get(basic_event_ptr e)
+	{
+		_Listener*& l = interned()[e];
+		if (l == NULL)
+			l = new _Listener(e);
+		return l;
+	}
+
+	void Bind(Widget w, const char* type)
+	{
+		bound.insert(std::make_pair(w, Rocket::Core::String(type)));
+		w->AddEventListener(type, this);
+	}
+
+	/// Removes every handler bind_event() gave the widget.
+	static void Release(Widget w)
+	{
+		std::vector<std::pair<_Listener*, Rocket::Core::String> > removals;
+
+		std::map<basic_event_ptr, _Listener*>& listeners = interned();
+		for (std::map<basic_event_ptr, _Listener*>::iterator it = listeners.begin(); it != listeners.end(); ++it)
+		{
+			std::pair<std::multimap<Rocket::Core::Element*, Rocket::Core::String>::iterator, std::multimap<Rocket::Core::Element*, Rocket::Core::String>::iterator> range = it->second->bound.equal_range(w);
+			for (; range.first != range.second; ++range.first)
+				removals.push_back(std::make_pair(it->second, range.first->second));
+		}
+
+		// a listener deletes itself when its last element lets go of it
+		for (size_t i = 0; i < removals.size(); i++)
+			w->RemoveEventListener(removals[i].second, removals[i].first);
+	}
 
 	void ProcessEvent(Rocket::Core::Event& event)
 	{
 		if (ev != NULL && !ev(event.GetType().CString(), event.GetTargetElement(), event))
 			event.StopPropagation();
 	}
-};
 
+	void OnAttach(Rocket::Core::Element*)
+	{
+		attachments++;
+	}
 
-/**
- * Initializes and creates the window.
- */
-static SDL_Window* _create_window(const char* title, int window_width, int window_height)
-{
-	SDL_Init(SDL_INIT_VIDEO);
-	SDL_Window* screen = SDL_CreateWindow(title, 20, 20, window_width, window_height, SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE);
-	SDL_GLContext glcontext = SDL_GL_CreateContext(screen);
-	
-	GLenum err = glewInit();
+	void OnDetach(Rocket::Core::Element* element)
+	{
+		std::multimap<Rocket::Core::Element*, Rocket::Core::String>::iterator it = bound.find(element);
+		if (it != bound.end())
+			bound.erase(it);
 
-	if (err != GLEW_OK)
-		fprintf(stderr, "GLEW ERROR: %s\n", glewGetErrorString(err));
+		if (--attachments > 0)
+			return;
 
-	SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
-	glMatrixMode(GL_PROJECTION | GL_MODELVIEW);
-	glLoadIdentity();
-	glOrtho(0, window_width, window_height, 0, 0, 1);
-	
-	return screen;
+		interned().erase(ev);
+		delete this;
+	}
+};
+
+static unsigned int _hash(const char* s, size_t n, unsigned int h = 2166136261u)
+{
+	for (size_t i = 0; i < n; i++)
+		h = (h ^ (unsigned char)s[i]) * 16777619u;
+	return h;
 }
 
-/**
- * Initializes and returns the renderer.
- */
-static SDL_Renderer* init_renderer(SDL_Window* screen)
+// Event delegation: one listener on a container handles an event type for
+// any descendant matching "#id", ".class" or a tag name. Handlers live in a
+// flat, open-addressed hash table keyed by (event type, selector).
+class _DelegateListener : public Rocket::Core::EventListener
 {
-	int oglIdx = -1;
-	int nRD = SDL_GetNumRenderDrivers();
+private:
+	struct entry
+	{
+		unsigned int hash;
+		Rocket::Core::String type;
+		Rocket::Core::String selector;
+		basic_event_ptr handler; // NULL marks an empty slot
+	};
 
-	for (int i = 0; i < nRD; i++)
+	Widget container;
+	std::vector<entry> table; // power of two size
+	size_t count;
+	int attachments; // one per event type
+
+	_DelegateListener(Widget c) : container(c), table(16), count(0), attachments(0) {}
+
+	static std::map<Widget, _DelegateListener*>& delegates()
 	{
-		SDL_RendererInfo info;
-		if (!SDL_GetRenderDriverInfo(i, &info))
+		static std::map<Widget, _DelegateListener*> listeners;
+		return listeners;
+	}
+
+	static unsigned int key(const Rocket::Core::String& type, const char* selector, size_t n)
+	{
+		return _hash(selector, n, _hash(type.CString(), type.Length()) ^ 0x9e3779b9u);
+	}
+
+	void insert(const entry& e)
+	{
+		size_t mask = table.size() - 1;
+		for (size_t i = e.hash & mask; ; i = (i + 1) & mask)
 		{
-			if (!strcmp(info.name, "opengl"))
+			if (table[i].handler == NULL || (table[i].hash == e.hash && table[i].type == e.type && table[i].selector == e.selector))
 			{
-				oglIdx = i;
+				if (table[i].handler == NULL)
+					count++;
+				table[i] = e;
+				return;
 			}
 		}
 	}
 
-	return SDL_CreateRenderer(screen, oglIdx, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
-}
+	basic_event_ptr find(const Rocket::Core::String& type, const char* selector, size_t n) const
+	{
+		unsigned int h = key(type, selector, n);
+		size_t mask = table.size() - 1;
 
-/**
- * Creates a "window." This is really just the root node of the DOM, as the actual
- * rendering window is created elsewhere.
- */
-void create_window(const char* title, int window_width = 1024, int window_height = 768)
-{
-	struct enstate* enstate = GetEngineState();
+		for (size_t i = h & mask; table[i].handler != NULL; i = (i + 1) & mask)
+		{
+			const entry& e = table[i];
+			if (e.hash == h && e.selector.Length() == n && !memcmp(e.selector.CString(), selector, n) && e.type == type)
+				return e.handler;
+		}
 
-	enstate->screen = _create_window(title, window_width, window_height);
-	enstate->renderer = init_renderer(enstate->screen);
+		return NULL;
+	}
 
-	enstate->rrenderer = new RocketSDL2Renderer(enstate->renderer, enstate->screen);
-	enstate->rsi = new RocketSDL2SystemInterface;
+	// runs the handler for one selector; false stops the event
+	bool dispatch(Rocket::Core::Event& event, Widget w, const char* selector, size_t n)
+	{
+		basic_event_ptr handler = find(event.GetType(), selector, n);
+		if (handler == NULL || handler(event.GetType().CString(), w, event))
+			return true;
 
-	Rocket::Core::SetRenderInterface(enstate->rrenderer);
-	Rocket::Core::SetSystemInterface(enstate->rsi);
+		event.StopPropagation();
+		return false;
+	}
 
-	if (!Rocket::Core::Initialise())
-		return;
+public:
+	static _DelegateListener* Get(Widget c)
+	{
+		_DelegateListener*& l = delegates()[c];
+		if (l == NULL)
+			l = new _DelegateListener(c);
+		return l;
+	}
 
-	Rocket::Controls::Initialise();
+	/// Returns true if this is the first handler for the event type.
+	bool Add(const char* type, const char* selector, basic_event_ptr handler)
+	{
+		bool first = true;
+		for (size_t i = 0; i < table.size(); i++)
+			if (table[i].handler != NULL && table[i].type == type)
+				first = false;
 
-	Rocket::Core::Context* context = Rocket::Core::CreateContext("default", Rocket::Core::Vector2i(window_width, window_height));
-	enstate->context = context;
+		// keep the load factor under one half
+		if ((count + 1) * 2 > table.size())
+		{
+			std::vector<entry> old(table.size() * 2);
+			old.swap(table);
+			count = 0;
+			for (size_t i = 0; i < old.size(); i++)
+				if (old[i].handler != NULL)
+					insert(old[i]);
+		}
 
-	Rocket::Debugger::Initialise(context);
+		entry e;
+		e.type = type;
+		e.selector = selector;
+		e.hash = key(e.type, selector, e.selector.Length());
+		e.handler = handler;
+		insert(e);
 
-	enstate->window_height = window_height;
-	enstate->window_width = window_width;
-	enstate->title = title;
+		return first;
+	}
 
-	// create the document
-	enstate->document = enstate->context->CreateDocument();
+	void ProcessEvent(Rocket::Core::Event& event)
+	{
+		char buffer[128];
 
-	if (enstate->document != NULL)
-		enstate->document->Show();
-	else
-		Rocket::Core::GetSystemInterface()->LogMessage(Rocket::Core::Log::Type::LT_ERROR, "Could not create the window.");
-}
+		// innermost match first, like normal bubbling
+		for (Widget w = event.GetTargetElement(); w != NULL; w = w->GetParentNode())
+		{
+			const Rocket::Core::String& id = w->GetId();
+			if (!id.Empty() && id.Length() < sizeof(buffer) - 1)
+			{
+				buffer[0] = '#';
+				memcpy(buffer + 1, id.CString(), id.Length());
+				if (!dispatch(event, w, buffer, id.Length() + 1))
+					return;
+			}
 
-/**
- * Sets the background color of the window.
- */
-void set_window_background_color(char background_r, char background_g, char background_b)
-{
-	struct enstate* enstate = GetEngineState();
-	enstate->clear_r = background_r;
-	enstate->clear_g = background_g;
-	enstate->clear_b = background_b;
-}
+			Rocket::Core::String classes = w->GetClassNames();
+			const char* c = classes.CString();
+			while (*c)
+			{
+				while (*c == ' ')
+					c++;
 
-/**
- * Creates a text block.
- */
-void load_font(const char* text)
-{
-	Rocket::Core::FontDatabase::LoadFontFace(text);
-}
+				size_t n = 0;
+				while (c[n] && c[n] != ' ')
+					n++;
 
-/**
- * Creates a text block.
- */
-Widget create_text(const char* text)
-{
-	struct enstate* enstate = GetEngineState();
+				if (n > 0 && n < sizeof(buffer) - 1)
+				{
+					buffer[0] = '.';
+					memcpy(buffer + 1, c, n);
+					if (!dispatch(event, w, buffer, n + 1))
+						return;
+				}
 
-	Rocket::Core::Element* new_element = enstate->document->CreateElement("p");
+				c += n;
+			}
 
-	// default font
-	new_element->SetProperty("font-family", DEFAULT_FONT);
+			const Rocket::Core::String& tag = w->GetTagName();
+			if (!dispatch(event, w, tag.CString(), tag.Length()))
+				return;
 
-	Rocket::Core::ElementText* new_text_element = enstate->document->CreateTextNode(text);
+			if (w == container)
+				break;
+		}
+	}
 
-	new_element->AppendChild(new_text_element);
-	enstate->document->AppendChild(new_element);
+	/// Removes every handler delegate_event() gave the container.
+	static void Release(Widget c)
+	{
+		std::map<Widget, _DelegateListener*>::iterator it = delegates().find(c);
+		if (it == delegates().end())
+			return;
+
+		_DelegateListener* l = it->second;
+
+		std::vector<Rocket::Core::String> types;
+		for (size_t i = 0; i < l->table.size(); i++)
+			if (l->table[i].handler != NULL && std::find(types.begin(), types.end(), l->table[i].type) == types.end())
+				types.push_back(l->table[i].type);
+
+		// the listener deletes itself when the last type is removed
+		for (size_t i = 0; i < types.size(); i++)
+			c->RemoveEventListener(types[i], l);
+	}
+
+	void OnAttach(Rocket::Core::Element*)
+	{
+		attachments++;
+	}
+
+	void OnDetach(Rocket::Core::Element*)
+	{
+		if (--attachments > 0)
+			return;
+
+		// the container is gone
+		delegates().erase(container);
+		delete this;
+	}
+};
 
-	return new_element;
-}
 
 /**
-* Sets the font itself
+* Sets a property now, or stages it if a batch is open.
 */
-void set_font(Widget w, const char* name)
+static void _set_property(Widget w, const Rocket::Core::String& name, const Rocket::Core::Property& property)
 {
-	w->SetProperty("font-family", name);
+	struct winstate* window = _window_of(w);
+
+	if (window->batch_depth > 0)
+	{
+		_staged_property staged;
+		staged.w = w;
+		staged.name = name;
+		staged.property = property;
+		staged.parsed = true;
+		window->batch_properties.push_back(staged);
+	}
+	else
+		w->SetProperty(name, property);
 }
 
-/**
- * Sets the text style. FONT_BOLD, FONT_ITALIC, or FONT_BOLD_AND_ITALIC.
- */
-void set_text_style(Widget w, int style)
+static void _set_property(Widget w, const Rocket::Core::String& name, const Rocket::Core::String& value)
 {
-	w->SetProperty("font-weight", style & FONT_BOLD ? "bold" : "normal");
-	w->SetProperty("font-style", style & FONT_ITALIC ? "italic" : "normal");
+	struct winstate* window = _window_of(w);
+
+	if (window->batch_depth > 0)
+	{
+		_staged_property staged;
+		staged.w = w;
+		staged.name = name;
+		staged.value = value;
+		staged.parsed = false;
+		window->batch_properties.push_back(staged);
+	}
+	else
+		w->SetProperty(name, value);
 }
 
 /**
-* Sets the font size.
+* Appends an element to its parent, or to the document if parentnode is
+* NULL. A detached element's hold on itself passes to its new parent.
 */
-void set_text_size(Widget w, int size)
+static void _append(struct winstate* window, Widget subnode, Widget parentnode)
 {
-	w->SetProperty("font-size", Rocket::Core::String(100, "%dpx", size).CString());
+	if (parentnode != NULL)
+		parentnode->AppendChild(subnode);
+	else
+		window->document->AppendChild(subnode);
+
+	if (window->detached.erase(subnode) > 0)
+		subnode->RemoveReference();
 }
 
 /**
-* Sets the background color.
+* Creates an element in the window's document, reusing one destroy() pooled
+* if there is one. The element starts out detached: its reference is the
+* window's until _append() hands it to a parent. If text isn't NULL the
+* element holds it as its one text node, which is reused along with a pooled
+* element.
 */
-void set_background_color(Widget w, const char* color)
+static Widget _create_element(struct winstate* window, const char* tag, const char* text = NULL)
 {
-	w->SetProperty("background-color", color);
+	Widget w;
+	Rocket::Core::ElementText* node = NULL;
+
+	std::unordered_map<std::string, std::vector<Rocket::Core::Element*> >::iterator pool = window->pools.find(tag);
+	if (pool == window->pools.end() || pool->second.empty())
+		w = window->document->CreateElement(tag);
+	else
+	{
+		w = pool->second.back();
+		pool->second.pop_back();
+
+		// destroy() leaves a lone text node in place
+		if (w->GetNumChildren() > 0)
+		{
+			node = text != NULL ? dynamic_cast<Rocket::Core::ElementText*>(w->GetFirstChild()) : NULL;
+			if (node == NULL)
+				w->RemoveChild(w->GetFirstChild());
+		}
+	}
+
+	if (node != NULL)
+		node->SetText(Rocket::Core::WString(text));
+	else if (text != NULL)
+	{
+		node = window->document->CreateTextNode(text);
+		w->AppendChild(node);
+		node->RemoveReference();
+	}
+
+	window->detached.insert(w);
+	return w;
 }
 
 /**
-* Sets the border
+* Parents an element now, or stages it if a batch is open. A NULL parent means
+* the root node of the current window.
 */
-void set_border(Widget w, const char* color, int borderWidth)
+static void _attach(Widget subnode, Widget parentnode)
 {
-	w->SetProperty("border", "solid");
-	w->SetProperty("border-width", Rocket::Core::String(100, "%dpx", borderWidth).CString());
-	w->SetProperty("border-color", color);
+	struct winstate* window = parentnode != NULL ? _window_of(parentnode) : GetWindowState();
+
+	if (window->batch_depth > 0)
+		window->batch_attachments.push_back(std::make_pair(subnode, parentnode));
+	else
+		_append(window, subnode, parentnode);
 }
 
 /**
-* Sets the font color.
+* Appends the children a batch has staged for parentnode now, so a change that
+* adds or replaces children comes after them, as it would outside a batch.
 */
-void set_text_color(Widget w, const char* color)
+static void _append_staged_children(Widget parentnode)
+{
+	struct winstate* window = _window_of(parentnode);
+
+	for (size_t i = 0; i < window->batch_attachments.size();)
+	{
+		if (window->batch_attachments[i].second == parentnode)
+		{
+			_append(window, window->batch_attachments[i].first, parentnode);
+			window->batch_attachments.erase(window->batch_attachments.begin() + i);
+		}
+		else
+			i++;
+	}
+}
+
+// id/class index
+//
+// get_widget_by_id() and get_widgets_by_class() look widgets up in hash
+// tables instead of walking the DOM. set_attribute("id"/"class"),
+// set_widget_class(), attach(), set_text(), load_document() and the shared
+// style classes keep the tables current, and a listener on every indexed
+// element removes it when the element is destroyed. Ids and classes set
+// straight through libRocket aren't seen; get_widget_by_id() falls back to a
+// walk for those, once per id until the next id is indexed.
+
+static void _unindex(struct winstate* window, Widget w)
 {
-	w->SetProperty("color", color);
+	std::unordered_map<Rocket::Core::Element*, _indexed>::iterator entry = window->indexed.find(w);
+	if (entry == window->indexed.end())
+		return;
+
+	std::unordered_map<std::string, Rocket::Core::Element*>::iterator id = window->id_index.find(entry->second.id);
+	if (id != window->id_index.end() && id->second == w)
+		window->id_index.erase(id);
+
+	for (size_t i = 0; i < entry->second.classes.size(); i++)
+	{
+		std::vector<Rocket::Core::Element*>& members = window->class_index[entry->second.classes[i]];
+		for (size_t j = 0; j < members.size(); j++)
+			if (members[j] == w)
+			{
+				members[j] = members.back();
+				members.pop_back();
+				break;
+			}
+	}
+
+	entry->second.id.clear();
+	entry->second.classes.clear();
 }
 
+// drops an element from the index when it is destroyed
+class _IndexListener : public Rocket::Core::EventListener
+{
+public:
+	static _IndexListener* Get()
+	{
+		static _IndexListener listener;
+		return &listener;
+	}
+
+	void ProcessEvent(Rocket::Core::Event&) {}
+
+	void OnDetach(Rocket::Core::Element* element)
+	{
+		// the element may already be out of its document; drop it from every window
+		std::vector<struct winstate*>& windows = GetEngineState()->windows;
+		for (size_t i = 0; i < windows.size(); i++)
+		{
+			_unindex(windows[i], element);
+			windows[i]->indexed.erase(element);
+		}
+	}
+};
+
 /**
-* Sets the widget's position
+* (Re)indexes a widget under its current id and classes.
 */
-void set_position(Widget w, int x, int y)
+static void _index(Widget w)
+{
+	struct winstate* window = _window_of(w);
+
+	if (window->indexed.find(w) == window->indexed.end())
+		w->AddEventListener("mingui-index", _IndexListener::Get());
+	else
+		_unindex(window, w);
+
+	_indexed& entry = window->indexed[w];
+
+	const Rocket::Core::String& id = w->GetId();
+	if (!id.Empty())
+	{
+		entry.id = id.CString();
+		window->id_index[entry.id] = w;
+		window->id_misses.clear();
+	}
+
+	Rocket::Core::String classes = w->GetClassNames();
+	const char* c = classes.CString();
+	while (*c)
+	{
+		while (*c == ' ')
+			c++;
+
+		size_t n = 0;
+		while (c[n] && c[n] != ' ')
+			n++;
+
+		if (n > 0)
+		{
+			entry.classes.push_back(std::string(c, n));
+			window->class_index[entry.classes.back()].push_back(w);
+		}
+
+		c += n;
+	}
+}
+
+static void _index_subtree(Widget w)
+{
+	if (!w->GetId().Empty() || w->HasAttribute("class"))
+		_index(w);
+
+	for (int i = 0; i < w->GetNumChildren(); i++)
+		_index_subtree(w->GetChild(i));
+}
+
+/**
+* Adds rules to a window's document style sheet. Where rules tie, the ones
+* combined last win, so base rules go first and generated classes last.
+*/
+static void _add_style_rules(struct winstate* window, const Rocket::Core::String& rcss, bool first = false)
+{
+	Rocket::Core::StyleSheet* rules = Rocket::Core::Factory::InstanceStyleSheetString(rcss);
+	if (rules == NULL)
+		return;
+
+	Rocket::Core::StyleSheet* current = window->document->GetStyleSheet();
+	if (current != NULL)
+	{
+		Rocket::Core::StyleSheet* combined = first ? rules->CombineStyleSheet(current) : current->CombineStyleSheet(rules);
+		window->document->SetStyleSheet(combined);
+		combined->RemoveReference();
+	}
+	else
+		window->document->SetStyleSheet(rules);
+
+	rules->RemoveReference();
+}
+
+/**
+* Gives a new document mingui's base style: the default font is inherited
+* from the body instead of being set on every element. A loaded document's
+* own rules take precedence.
+*/
+static void _init_document_style(struct winstate* window)
+{
+	window->style_classes.clear();
+	_add_style_rules(window, "body { font-family: " DEFAULT_FONT "; }", true);
+}
+
+// properties that place one particular element; these stay inline
+static bool _is_placement_property(const std::string& name)
+{
+	return name == "position" || name == "left" || name == "top" || name == "right" || name == "bottom"
+		|| name == "margin-top" || name == "margin-right" || name == "margin-bottom" || name == "margin-left";
+}
+
+// one element's staged style, reduced to its final longhand properties
+struct _batched_style
+{
+	Rocket::Core::Element* w;
+	std::map<std::string, Rocket::Core::Property> properties;
+	std::string rcss; // the shareable properties as rcss, or empty if they can't be shared
+};
+
+/**
+* Whether an earlier batch gave the element one of the window's generated
+* classes.
+*/
+static bool _has_style_class(struct winstate* window, Widget w)
+{
+	Rocket::Core::String classes = w->GetClassNames();
+	const char* c = classes.CString();
+	while (*c)
+	{
+		while (*c == ' ')
+			c++;
+
+		size_t n = 0;
+		while (c[n] && c[n] != ' ')
+			n++;
+
+		if (n > 2 && c[0] == 'm' && c[1] == 'g' && strspn(c + 2, "0123456789") == n - 2)
+		{
+			size_t number = (size_t)atoi(c + 2);
+			if (number >= 1 && number <= window->style_classes.size())
+				return true;
+		}
+
+		c += n;
+	}
+
+	return false;
+}
+
+/**
+* Applies a window's staged properties. Elements in the batch that end up
+* with the same non-placement properties share a generated class ("mg1",
+* "mg2", ...) instead of each holding its own copies; the class is created
+* the first time a combination is seen on two elements and reused by later
+* batches. Placement properties, and combinations only one element has,
+* are set inline.
+*
+* An element already given a class by an earlier batch keeps it and has
+* this batch's properties set inline, so the latest write wins whatever
+* order the rules are in. Inline values set before the batch are removed
+* where the class takes their place, so they don't hide it.
+*/
+static void _commit_batch_properties(struct winstate* window)
+{
+	struct enstate* enstate = GetEngineState();
+	std::vector<_staged_property>& staged = window->batch_properties;
+
+	std::vector<_batched_style> styles;
+	std::unordered_map<Rocket::Core::Element*, size_t> style_of;
+
+	for (size_t i = 0; i < staged.size(); i++)
+	{
+		std::pair<std::unordered_map<Rocket::Core::Element*, size_t>::iterator, bool> slot = style_of.insert(std::make_pair(staged[i].w, styles.size()));
+		if (slot.second)
+		{
+			styles.push_back(_batched_style());
+			styles.back().w = staged[i].w;
+		}
+
+		_batched_style& style = styles[slot.first->second];
+
+		if (staged[i].parsed)
+		{
+			style.properties[staged[i].name.CString()] = staged[i].property;
+			continue;
+		}
+
+		// shorthands expand to longhands here, so later writes replace earlier ones property by property
+		Rocket::Core::PropertyDictionary parsed;
+		if (!Rocket::Core::StyleSheetSpecification::ParsePropertyDeclaration(parsed, staged[i].name, staged[i].value))
+			continue; // SetProperty() would have rejected it too
+
+		const Rocket::Core::PropertyMap& properties = parsed.GetProperties();
+		for (Rocket::Core::PropertyMap::const_iterator it = properties.begin(); it != properties.end(); ++it)
+			style.properties[it->first.CString()] = it->second;
+	}
+
+	std::unordered_map<std::string, int> uses;
+
+#ifndef MINGUI_INLINE_STYLES
+	for (size_t i = 0; i < styles.size(); i++)
+	{
+		_batched_style& style = styles[i];
+
+		if (_has_style_class(window, style.w))
+			continue;
+
+		// std::map keeps the names sorted, so equal styles give equal rcss
+		Rocket::Core::String value;
+		for (std::map<std::string, Rocket::Core::Property>::iterator it = style.properties.begin(); it != style.properties.end(); ++it)
+		{
+			if (_is_placement_property(it->first))
+				continue;
+
+			const Rocket::Core::PropertyDefinition* definition = Rocket::Core::StyleSheetSpecification::GetProperty(it->first.c_str());
+			if (definition == NULL || !definition->GetValue(value, it->second))
+			{
+				style.rcss.clear();
+				break;
+			}
+
+			style.rcss += it->first + ": " + value.CString() + "; ";
+		}
+
+		if (!style.rcss.empty())
+			uses[style.rcss]++;
+	}
+#endif
+
+	Rocket::Core::String rules;
+
+	for (size_t i = 0; i < styles.size(); i++)
+	{
+		_batched_style& style = styles[i];
+		bool shared = !style.rcss.empty() && (uses[style.rcss] > 1 || window->style_classes.count(style.rcss) > 0);
+
+		if (shared)
+		{
+			std::string& name = window->style_classes[style.rcss];
+			if (name.empty())
+			{
+				name = "mg" + std::to_string(window->style_classes.size());
+				rules += ("." + name + " { " + style.rcss + "}\n").c_str();
+				enstate->style_classes_created++;
+			}
+
+			style.w->SetClass(name.c_str(), true);
+			_index(style.w);
+			enstate->style_elements_interned++;
+		}
+
+		for (std::map<std::string, Rocket::Core::Property>::iterator it = style.properties.begin(); it != style.properties.end(); ++it)
+		{
+			if (!shared || _is_placement_property(it->first))
+				style.w->SetProperty(it->first.c_str(), it->second);
+			else
+			{
+				style.w->RemoveProperty(it->first.c_str());
+				enstate->style_properties_interned++;
+			}
+		}
+	}
+
+	if (!rules.Empty())
+		_add_style_rules(window, rules);
+}
+
+/**
+* How many style classes batches have generated, how many elements use one,
+* and how many inline properties those elements would otherwise each hold.
+*/
+void get_style_stats(int* classes, int* elements, int* properties)
+{
+	struct enstate* enstate = GetEngineState();
+	*classes = enstate->style_classes_created;
+	*elements = enstate->style_elements_interned;
+	*properties = enstate->style_properties_interned;
+}
+
+/**
+* Starts a batch. Until the matching end_batch(), property writes and
+* parenting done through mingui are staged instead of applied, and the
+* current window's layout is locked. Batches may be nested.
+*/
+void begin_batch()
+{
+	struct winstate* window = GetWindowState();
+
+	if (window->batch_depth++ == 0)
+		window->document->LockLayout(true);
+}
+
+/**
+* Ends a batch. The outermost end_batch() applies all staged properties while
+* the new elements are still detached, sharing style classes between
+* elements styled alike, attaches them in the order they were added, and
+* unlocks layout so the document is laid out once.
+*/
+void end_batch()
+{
+	struct winstate* window = GetWindowState();
+
+	if (window->batch_depth == 0 || --window->batch_depth > 0)
+		return;
+
+	_commit_batch_properties(window);
+
+	for (size_t i = 0; i < window->batch_attachments.size(); i++)
+	{
+		_append(window, window->batch_attachments[i].first, window->batch_attachments[i].second);
+	}
+
+	window->batch_properties.clear();
+	window->batch_attachments.clear();
+
+	window->document->LockLayout(false);
+}
+
+/**
+* Opens a batch for the lifetime of the object.
+*/
+class batch_scope
+{
+public:
+	batch_scope() { begin_batch(); }
+	~batch_scope() { end_batch(); }
+
+private:
+	batch_scope(const batch_scope&);
+	batch_scope& operator=(const batch_scope&);
+};
+
+
+// typed properties
+//
+// set<Width>(w, 16, PX) builds a Rocket::Core::Property directly instead of
+// formatting "16px" and having libRocket parse it back. Each property tag
+// carries its RCSS name and the kind of value it takes, so passing the wrong
+// kind of value is a compile error.
+
+enum { PROP_LENGTH, PROP_NUMBER, PROP_KEYWORD, PROP_COLOUR };
+
+typedef Rocket::Core::Property::Unit PropertyUnit;
+static const PropertyUnit PX		= Rocket::Core::Property::PX;
+static const PropertyUnit EM		= Rocket::Core::Property::EM;
+static const PropertyUnit PERCENT	= Rocket::Core::Property::PERCENT;
+static const PropertyUnit NUMBER	= Rocket::Core::Property::NUMBER;
+
+#define MINGUI_PROPERTY(tag, rcss_name, value_kind) \
+	struct tag \
+	{ \
+		static const int kind = value_kind; \
+		static const Rocket::Core::String& name() { static const Rocket::Core::String n(rcss_name); return n; } \
+	};
+
+MINGUI_PROPERTY(Width,				"width",				PROP_LENGTH)
+MINGUI_PROPERTY(Height,				"height",				PROP_LENGTH)
+MINGUI_PROPERTY(Left,				"left",					PROP_LENGTH)
+MINGUI_PROPERTY(Top,				"top",					PROP_LENGTH)
+MINGUI_PROPERTY(Right,				"right",				PROP_LENGTH)
+MINGUI_PROPERTY(Bottom,				"bottom",				PROP_LENGTH)
+MINGUI_PROPERTY(MarginTop,			"margin-top",			PROP_LENGTH)
+MINGUI_PROPERTY(MarginRight,		"margin-right",			PROP_LENGTH)
+MINGUI_PROPERTY(MarginBottom,		"margin-bottom",		PROP_LENGTH)
+MINGUI_PROPERTY(MarginLeft,			"margin-left",			PROP_LENGTH)
+MINGUI_PROPERTY(PaddingTop,			"padding-top",			PROP_LENGTH)
+MINGUI_PROPERTY(PaddingRight,		"padding-right",		PROP_LENGTH)
+MINGUI_PROPERTY(PaddingBottom,		"padding-bottom",		PROP_LENGTH)
+MINGUI_PROPERTY(PaddingLeft,		"padding-left",			PROP_LENGTH)
+MINGUI_PROPERTY(BorderTopWidth,		"border-top-width",		PROP_LENGTH)
+MINGUI_PROPERTY(BorderRightWidth,	"border-right-width",	PROP_LENGTH)
+MINGUI_PROPERTY(BorderBottomWidth,	"border-bottom-width",	PROP_LENGTH)
+MINGUI_PROPERTY(BorderLeftWidth,	"border-left-width",	PROP_LENGTH)
+MINGUI_PROPERTY(FontSize,			"font-size",			PROP_LENGTH)
+MINGUI_PROPERTY(ZIndex,				"z-index",				PROP_NUMBER)
+MINGUI_PROPERTY(Position,			"position",				PROP_KEYWORD)
+MINGUI_PROPERTY(FontWeight,			"font-weight",			PROP_KEYWORD)
+MINGUI_PROPERTY(FontStyle,			"font-style",			PROP_KEYWORD)
+MINGUI_PROPERTY(TextAlign,			"text-align",			PROP_KEYWORD)
+MINGUI_PROPERTY(Color,				"color",				PROP_COLOUR)
+MINGUI_PROPERTY(BackgroundColor,	"background-color",		PROP_COLOUR)
+MINGUI_PROPERTY(BorderTopColor,		"border-top-color",		PROP_COLOUR)
+MINGUI_PROPERTY(BorderRightColor,	"border-right-color",	PROP_COLOUR)
+MINGUI_PROPERTY(BorderBottomColor,	"border-bottom-color",	PROP_COLOUR)
+MINGUI_PROPERTY(BorderLeftColor,	"border-left-color",	PROP_COLOUR)
+
+/**
+* Sets a property from a typed value. Building with MINGUI_STRING_PROPERTIES
+* formats it as RCSS for libRocket to parse instead, the old path, to compare
+* construction times against.
+*/
+static void _set_typed_property(Widget w, const Rocket::Core::String& name, const Rocket::Core::Property& property)
+{
+#ifdef MINGUI_STRING_PROPERTIES
+	Rocket::Core::String value;
+	const Rocket::Core::PropertyDefinition* definition = Rocket::Core::StyleSheetSpecification::GetProperty(name);
+	if (definition != NULL && definition->GetValue(value, property))
+	{
+		_set_property(w, name, value);
+		return;
+	}
+#endif
+	_set_property(w, name, property);
+}
+
+/**
+* Sets a length or number property, e.g. set<Width>(w, 16, PX) or set<ZIndex>(w, 9, NUMBER).
+*/
+template <typename P>
+inline void set(Widget w, float value, PropertyUnit unit = PX)
+{
+	static_assert(P::kind == PROP_LENGTH || P::kind == PROP_NUMBER, "property does not take a length or number");
+	_set_typed_property(w, P::name(), Rocket::Core::Property(value, unit));
+}
+
+/**
+* Sets a keyword property from libRocket's keyword constants, e.g. set_keyword<Position>(w, Rocket::Core::POSITION_ABSOLUTE).
+*/
+template <typename P>
+inline void set_keyword(Widget w, int keyword)
+{
+	static_assert(P::kind == PROP_KEYWORD, "property does not take a keyword");
+	_set_typed_property(w, P::name(), Rocket::Core::Property(keyword, Rocket::Core::Property::KEYWORD));
+}
+
+/**
+* Sets a colour property, e.g. set<Color>(w, Rocket::Core::Colourb(255, 255, 255)).
+*/
+template <typename P>
+inline void set(Widget w, const Rocket::Core::Colourb& colour)
+{
+	static_assert(P::kind == PROP_COLOUR, "property does not take a colour");
+	_set_typed_property(w, P::name(), Rocket::Core::Property(colour, Rocket::Core::Property::COLOUR));
+}
+
+
+/**
+ * Initializes and creates the window.
+ */
+static SDL_Window* _create_window(const char* title, int window_width, int window_height, SDL_GLContext* glcontext)
+{
+	SDL_Window* screen = SDL_CreateWindow(title, 20, 20, window_width, window_height, SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE);
+	*glcontext = SDL_GL_CreateContext(screen);
+	
+	GLenum err = glewInit();
+
+	if (err != GLEW_OK)
+		fprintf(stderr, "GLEW ERROR: %s\n", glewGetErrorString(err));
+
+	SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
+	glMatrixMode(GL_PROJECTION | GL_MODELVIEW);
+	glLoadIdentity();
+	glOrtho(0, window_width, window_height, 0, 0, 1);
+	
+	return screen;
+}
+
+/**
+ * Initializes and returns the renderer. Only one window waits for vsync, so
+ * presenting several windows per frame doesn't stretch the frame.
+ */
+static SDL_Renderer* init_renderer(SDL_Window* screen, bool vsync)
+{
+	int oglIdx = -1;
+	int nRD = SDL_GetNumRenderDrivers();
+
+	for (int i = 0; i < nRD; i++)
+	{
+		SDL_RendererInfo info;
+		if (!SDL_GetRenderDriverInfo(i, &info))
+		{
+			if (!strcmp(info.name, "opengl"))
+			{
+				oglIdx = i;
+			}
+		}
+	}
+
+	return SDL_CreateRenderer(screen, oglIdx, SDL_RENDERER_ACCELERATED | (vsync ? SDL_RENDERER_PRESENTVSYNC : 0));
+}
+
+/**
+ * Starts SDL and libRocket. Done once, by the first create_window().
+ */
+static bool _init_engine(RENDERER* rrenderer)
+{
+	struct enstate* enstate = GetEngineState();
+
+	enstate->rsi = new RocketSDL2SystemInterface;
+
+	// the first window's renderer is also the default for anything not tied to a context
+	Rocket::Core::SetRenderInterface(rrenderer);
+	Rocket::Core::SetSystemInterface(enstate->rsi);
+
+	if (!Rocket::Core::Initialise())
+		return false;
+
+	Rocket::Controls::Initialise();
+
+	// mingui's own elements
+	Rocket::Core::ElementInstancer* tilemap_instancer = new Rocket::Core::ElementInstancerGeneric<ElementTileMap>();
+	Rocket::Core::Factory::RegisterElementInstancer("tilemap", tilemap_instancer);
+	tilemap_instancer->RemoveReference();
+
+	Rocket::Core::ElementInstancer* canvas_instancer = new Rocket::Core::ElementInstancerGeneric<ElementCanvas>();
+	Rocket::Core::Factory::RegisterElementInstancer("canvas", canvas_instancer);
+	canvas_instancer->RemoveReference();
+
+	Rocket::Core::ElementInstancer* sprite_instancer = new Rocket::Core::ElementInstancerGeneric<ElementSprite>();
+	Rocket::Core::Factory::RegisterElementInstancer("sprite", sprite_instancer);
+	sprite_instancer->RemoveReference();
+
+	Rocket::Core::ElementInstancer* list_instancer = new Rocket::Core::ElementInstancerGeneric<ElementVirtualList>();
+	Rocket::Core::Factory::RegisterElementInstancer("virtuallist", list_instancer);
+	list_instancer->RemoveReference();
+
+	return true;
+}
+
+/**
+ * Creates a window with its own renderer, context and document, and makes it
+ * the current window. Can be called more than once; StartGame() drives every
+ * window that is open. Returns NULL if the window could not be created.
+ */
+Window create_window(const char* title, int window_width = 1024, int window_height = 768)
+{
+	struct enstate* enstate = GetEngineState();
+	bool first = enstate->rsi == NULL;
+
+	if (first)
+		SDL_Init(SDL_INIT_VIDEO);
+
+	struct winstate* window = new winstate();
+	window->screen = _create_window(title, window_width, window_height, &window->glcontext);
+	window->renderer = init_renderer(window->screen, first);
+	window->rrenderer = new RocketSDL2Renderer(window->renderer, window->screen);
+	window->window_id = SDL_GetWindowID(window->screen);
+
+	if (first && !_init_engine(window->rrenderer))
+		return NULL;
+
+	// contexts need unique names; each renders through its own window's renderer
+	Rocket::Core::String name(32, "window%u", window->window_id);
+	window->context = Rocket::Core::CreateContext(name, Rocket::Core::Vector2i(window_width, window_height), window->rrenderer);
+
+	// the debugger can only attach to one context; it lives in the first window
+	if (first)
+		Rocket::Debugger::Initialise(window->context);
+
+	window->window_height = window_height;
+	window->window_width = window_width;
+	window->title = title;
+
+	// create the document
+	window->document = window->context->CreateDocument();
+
+	if (window->document != NULL)
+	{
+		_init_document_style(window);
+		window->document->Show();
+	}
+	else
+		Rocket::Core::GetSystemInterface()->LogMessage(Rocket::Core::Log::Type::LT_ERROR, "Could not create the window.");
+
+	enstate->windows.push_back(window);
+	enstate->current = window;
+	return window;
+}
+
+/**
+ * Makes a window the one new widgets are created in.
+ */
+void set_current_window(Window window)
+{
+	GetEngineState()->current = window;
+}
+
+/**
+ * Gets the window new widgets are created in.
+ */
+Window get_current_window()
+{
+	return GetEngineState()->current;
+}
+
+/**
+ * Releases a window's context, and the widgets its translations hold on to.
+ */
+static void _release_context(struct winstate* window)
+{
+	for (size_t i = 0; i < window->translations.size(); i++)
+		window->translations[i].w->RemoveReference();
+	window->translations.clear();
+	window->translation_slots.clear();
+
+	for (size_t i = 0; i < window->bindings.size(); i++)
+		window->bindings[i].w->RemoveReference();
+	window->bindings.clear();
+
+	for (size_t i = 0; i < window->tweens.size(); i++)
+		window->tweens[i].w->RemoveReference();
+	window->tweens.clear();
+
+	for (std::unordered_map<std::string, std::vector<Rocket::Core::Element*> >::iterator it = window->pools.begin(); it != window->pools.end(); ++it)
+		for (size_t i = 0; i < it->second.size(); i++)
+			it->second[i]->RemoveReference();
+	window->pools.clear();
+
+	for (std::unordered_set<Rocket::Core::Element*>::iterator it = window->detached.begin(); it != window->detached.end(); ++it)
+		(*it)->RemoveReference();
+	window->detached.clear();
+
+	for (std::unordered_map<std::string, Rocket::Core::Texture*>::iterator it = window->draw_textures.begin(); it != window->draw_textures.end(); ++it)
+		delete it->second;
+	window->draw_textures.clear();
+
+	for (std::unordered_map<std::string, Rocket::Core::FontFaceHandle*>::iterator it = window->draw_fonts.begin(); it != window->draw_fonts.end(); ++it)
+		if (it->second != NULL)
+			it->second->RemoveReference();
+	window->draw_fonts.clear();
+
+	window->context->UnloadAllDocuments();
+	window->context->RemoveReference();
+	window->context = NULL;
+	window->document = NULL;
+}
+
+/**
+ * Releases a window's renderer and SDL window. Its context must be gone.
+ */
+static void _destroy_window(struct winstate* window)
+{
+	delete window->rrenderer;
+
+	SDL_DestroyRenderer(window->renderer);
+	SDL_GL_DeleteContext(window->glcontext);
+	SDL_DestroyWindow(window->screen);
+
+	delete window;
+}
+
+/**
+ * Closes a window. It is destroyed at the end of the frame, so this is safe to
+ * call from its own event handlers. The game keeps running until the last
+ * window is closed.
+ */
+void close_window(Window window)
+{
+	window->closed = true;
+}
+
+/**
+ * Destroys the windows closed during this frame.
+ */
+static void _reap_windows()
+{
+	struct enstate* enstate = GetEngineState();
+
+	for (size_t i = 0; i < enstate->windows.size();)
+	{
+		struct winstate* window = enstate->windows[i];
+		if (!window->closed)
+		{
+			i++;
+			continue;
+		}
+
+		enstate->windows.erase(enstate->windows.begin() + i);
+		if (enstate->current == window)
+			enstate->current = enstate->windows.empty() ? NULL : enstate->windows[0];
+
+		// textures are cached per renderer; drop them before this one goes away
+		_release_context(window);
+		Rocket::Core::ReleaseTextures();
+		_destroy_window(window);
+	}
+
+	if (enstate->windows.empty())
+		enstate->exit = true;
+}
+
+/**
+ * Sets the background color of the current window.
+ */
+void set_window_background_color(char background_r, char background_g, char background_b)
+{
+	struct winstate* window = GetWindowState();
+	window->clear_r = background_r;
+	window->clear_g = background_g;
+	window->clear_b = background_b;
+}
+
+/**
+ * Creates a text block.
+ */
+void load_font(const char* text)
+{
+	Rocket::Core::FontDatabase::LoadFontFace(text);
+}
+
+/**
+ * Creates a text block.
+ */
+Widget create_text(const char* text)
+{
+	struct winstate* window = GetWindowState();
+
+	Rocket::Core::Element* new_element = _create_element(window, "p", text);
+	_attach(new_element, NULL);
+
+	return new_element;
+}
+
+/**
+* Sets the font itself
+*/
+void set_font(Widget w, const char* name)
+{
+	_set_property(w, "font-family", name);
+}
+
+/**
+ * Sets the text style. FONT_BOLD, FONT_ITALIC, or FONT_BOLD_AND_ITALIC.
+ */
+void set_text_style(Widget w, int style)
+{
+	set_keyword<FontWeight>(w, style & FONT_BOLD ? Rocket::Core::FONT_WEIGHT_BOLD : Rocket::Core::FONT_WEIGHT_NORMAL);
+	set_keyword<FontStyle>(w, style & FONT_ITALIC ? Rocket::Core::FONT_STYLE_ITALIC : Rocket::Core::FONT_STYLE_NORMAL);
+}
+
+/**
+* Sets the font size.
+*/
+void set_text_size(Widget w, int size)
+{
+	set<FontSize>(w, (float)size, PX);
+}
+
+/**
+* Sets the background color.
+*/
+void set_background_color(Widget w, const char* color)
+{
+	_set_property(w, "background-color", color);
+}
+
+/**
+* Sets the border
+*/
+void set_border(Widget w, const char* color, int borderWidth)
+{
+	_set_property(w, "border", "solid");
+	set<BorderTopWidth>(w, (float)borderWidth, PX);
+	set<BorderRightWidth>(w, (float)borderWidth, PX);
+	set<BorderBottomWidth>(w, (float)borderWidth, PX);
+	set<BorderLeftWidth>(w, (float)borderWidth, PX);
+	_set_property(w, "border-color", color);
+}
+
+/**
+* Sets the font color.
+*/
+void set_text_color(Widget w, const char* color)
+{
+	_set_property(w, "color", color);
+}
+
+/**
+* Sets the widget's position
+*/
+void set_position(Widget w, int x, int y)
+{
+	set_keyword<Position>(w, Rocket::Core::POSITION_ABSOLUTE);
+
+	// same as "margin: ypx xpx"
+	set<MarginTop>(w, (float)y, PX);
+	set<MarginRight>(w, (float)x, PX);
+	set<MarginBottom>(w, (float)y, PX);
+	set<MarginLeft>(w, (float)x, PX);
+}
+
+/**
+* The widget's slot in the window's translations, or -1 if it has none.
+*/
+static int _translation_slot(struct winstate* window, Widget w)
+{
+	std::unordered_map<Rocket::Core::Element*, size_t>::iterator it = window->translation_slots.find(w);
+	return it == window->translation_slots.end() ? -1 : (int)it->second;
+}
+
+/**
+* Drops a translation and the reference it holds; the last one moves into its slot.
+*/
+static void _remove_translation(struct winstate* window, size_t slot)
+{
+	window->translation_slots.erase(window->translations[slot].w);
+	window->translations[slot].w->RemoveReference();
+
+	if (slot + 1 < window->translations.size())
+	{
+		window->translations[slot] = window->translations.back();
+		window->translation_slots[window->translations[slot].w] = slot;
+	}
+
+	window->translations.pop_back();
+}
+
+/**
+* Moves the widget by (x, y) pixels from where layout placed it, without
+* changing any layout property. Only the widget and its children are
+* re-rendered; nothing is laid out again. Use this for things that move
+* often. Works for static and absolutely positioned widgets.
+*/
+void set_translation(Widget w, float x, float y)
+{
+	struct winstate* window = _window_of(w);
+
+	int slot = _translation_slot(window, w);
+	if (slot >= 0)
+	{
+		_translation& t = window->translations[slot];
+		if (t.offset.x != x || t.offset.y != y)
+		{
+			t.offset = Rocket::Core::Vector2f(x, y);
+			t.dirty = true;
+		}
+		return;
+	}
+
+	_translation t;
+	t.w = w;
+	t.offset = Rocket::Core::Vector2f(x, y);
+	t.placed = false;
+	t.dirty = true;
+
+	// hold on to the widget while it has a translation
+	w->AddReference();
+	window->translation_slots[w] = window->translations.size();
+	window->translations.push_back(t);
+}
+
+/**
+* Removes the widget's translation; it goes back to its laid out position.
+*/
+void clear_translation(Widget w)
+{
+	struct winstate* window = _window_of(w);
+
+	int slot = _translation_slot(window, w);
+	if (slot < 0)
+		return;
+
+	_translation& t = window->translations[slot];
+	if (t.placed && w->GetRelativeOffset(Rocket::Core::Box::BORDER) == t.applied)
+		w->SetOffset(t.base, w->GetOffsetParent());
+
+	_remove_translation(window, slot);
+}
+
+/**
+* Applies translations right before rendering. If layout ran since the last
+* frame it has put the widget back at its laid out position, so that position
+* becomes the new base.
+*
+* GetRelativeOffset() adds the margin and any left/top to what SetOffset() was
+* given, so the base is found by setting a zero offset and reading back what
+* gets added. That only happens after a relayout.
+*/
+static void _apply_translations(struct winstate* window)
+{
+	for (size_t i = 0; i < window->translations.size(); i++)
+	{
+		_translation& t = window->translations[i];
+		Rocket::Core::Vector2f current = t.w->GetRelativeOffset(Rocket::Core::Box::BORDER);
+
+		if (!t.placed || current != t.applied)
+		{
+			t.w->SetOffset(Rocket::Core::Vector2f(0, 0), t.w->GetOffsetParent());
+			t.layout = current;
+			t.base = current - t.w->GetRelativeOffset(Rocket::Core::Box::BORDER);
+			t.dirty = true;
+		}
+
+		if (t.dirty)
+		{
+			t.applied = t.layout + t.offset;
+			t.w->SetOffset(t.base + t.offset, t.w->GetOffsetParent());
+			t.placed = true;
+			t.dirty = false;
+		}
+	}
+}
+
+
+// animation
+//
+// animate() and friends change render-time values only: translations,
+// colours, and a sprite's scale and opacity. None of them lay anything out
+// again. Running tweens live in one array per window and are all advanced
+// in a single pass just before the window renders, on the frame clock.
+
+static float _ease(int easing, float t)
+{
+	switch (easing)
+	{
+	case EASE_IN:		return t * t;
+	case EASE_OUT:		return t * (2 - t);
+	case EASE_IN_OUT:	return t < 0.5f ? 2 * t * t : -1 + (4 - 2 * t) * t;
+	default:			return t;
+	}
+}
+
+/**
+* Reads the value a tween of this property would start from.
+*/
+static void _tween_current(struct winstate* window, Widget w, int property, float* value)
+{
+	ElementSprite* sprite = dynamic_cast<ElementSprite*>(w);
+
+	switch (property)
+	{
+	case ANIM_TRANSLATION:
+	{
+		int slot = _translation_slot(window, w);
+		value[0] = slot >= 0 ? window->translations[slot].offset.x : 0;
+		value[1] = slot >= 0 ? window->translations[slot].offset.y : 0;
+		break;
+	}
+
+	case ANIM_OPACITY:
+		value[0] = sprite != NULL ? sprite->GetOpacity() : w->GetProperty<Rocket::Core::Colourb>("color").alpha / 255.0f;
+		break;
+
+	case ANIM_SCALE:
+		value[0] = sprite != NULL ? sprite->GetScale() : 1;
+		break;
+
+	case ANIM_COLOR:
+		{
+			Rocket::Core::Colourb colour = w->GetProperty<Rocket::Core::Colourb>("color");
+			value[0] = colour.red;
+			value[1] = colour.green;
+			value[2] = colour.blue;
+			value[3] = colour.alpha;
+		}
+		break;
+	}
+}
+
+static void _tween_apply(Widget w, int property, const float* value)
+{
+	ElementSprite* sprite = dynamic_cast<ElementSprite*>(w);
+
+	switch (property)
+	{
+	case ANIM_TRANSLATION:
+		set_translation(w, value[0], value[1]);
+		break;
+
+	case ANIM_OPACITY:
+		if (sprite != NULL)
+			sprite->SetOpacity(value[0]);
+		else
+		{
+			// text fades through its colour's alpha
+			Rocket::Core::Colourb colour = w->GetProperty<Rocket::Core::Colourb>("color");
+			colour.alpha = (Rocket::Core::byte)(value[0] * 255 + 0.5f);
+			w->SetProperty("color", Rocket::Core::Property(colour, Rocket::Core::Property::COLOUR));
+		}
+		break;
+
+	case ANIM_SCALE:
+		if (sprite != NULL)
+			sprite->SetScale(value[0]);
+		break;
+
+	case ANIM_COLOR:
+		w->SetProperty("color", Rocket::Core::Property(Rocket::Core::Colourb((Rocket::Core::byte)(value[0] + 0.5f), (Rocket::Core::byte)(value[1] + 0.5f), (Rocket::Core::byte)(value[2] + 0.5f), (Rocket::Core::byte)(value[3] + 0.5f)), Rocket::Core::Property::COLOUR));
+		break;
+	}
+}
+
+static void _tween_start(Widget w, int property, const float* to, int values, int duration_ms, int easing)
+{
+	struct winstate* window = _window_of(w);
+
+	_tween tween;
+	tween.w = w;
+	tween.property = property;
+	tween.easing = easing;
+	tween.start = GetEngineState()->rsi->GetElapsedTime();
+	tween.duration = duration_ms / 1000.0f;
+	_tween_current(window, w, property, tween.from);
+	for (int i = 0; i < values; i++)
+		tween.to[i] = to[i];
+
+	// a new tween of the same property takes over from wherever the old one got to
+	for (size_t i = 0; i < window->tweens.size(); i++)
+		if (window->tweens[i].w == w && window->tweens[i].property == property)
+		{
+			window->tweens[i] = tween;
+			return;
+		}
+
+	// hold on to the widget while it animates
+	w->AddReference();
+	window->tweens.push_back(tween);
+}
+
+/**
+* Advances every tween in the window and applies its value; finished tweens
+* get their final value and are dropped.
+*/
+static void _advance_tweens(struct winstate* window)
+{
+	if (window->tweens.empty())
+		return;
+
+	struct enstate* enstate = GetEngineState();
+	Uint64 start = SDL_GetPerformanceCounter();
+	float now = enstate->rsi->GetElapsedTime();
+	window->tween_count += (int)window->tweens.size();
+
+	for (size_t i = 0; i < window->tweens.size();)
+	{
+		_tween& tween = window->tweens[i];
+
+		float t = tween.duration > 0 ? (now - tween.start) / tween.duration : 1;
+		bool finished = t >= 1;
+		float k = _ease(tween.easing, finished ? 1 : (t > 0 ? t : 0));
+
+		float value[4];
+		for (int j = 0; j < 4; j++)
+			value[j] = tween.from[j] + (tween.to[j] - tween.from[j]) * k;
+
+		_tween_apply(tween.w, tween.property, value);
+
+		if (finished)
+		{
+			tween.w->RemoveReference();
+			tween = window->tweens.back();
+			window->tweens.pop_back();
+		}
+		else
+			i++;
+	}
+
+	window->tween_ticks += SDL_GetPerformanceCounter() - start;
+	window->tween_frames++;
+}
+
+/**
+* Animates a widget's opacity (ANIM_OPACITY, 0 to 1) or a sprite's scale
+* (ANIM_SCALE, 1 is its normal size) to a value over duration_ms, starting
+* from where it is now. easing is EASE_LINEAR, EASE_IN, EASE_OUT or
+* EASE_IN_OUT. Nothing is laid out again while it runs. Opacity fades a
+* sprite's image, and other widgets' text.
+*/
+void animate(Widget w, int property, float to, int duration_ms, int easing = EASE_LINEAR)
+{
+	if (property != ANIM_OPACITY && property != ANIM_SCALE)
+		return;
+
+	float value[4] = { to, 0, 0, 0 };
+	_tween_start(w, property, value, 1, duration_ms, easing);
+}
+
+/**
+* Slides a widget to a translation (see set_translation()) over duration_ms.
+*/
+void animate_translation(Widget w, float x, float y, int duration_ms, int easing = EASE_LINEAR)
+{
+	float value[4] = { x, y, 0, 0 };
+	_tween_start(w, ANIM_TRANSLATION, value, 2, duration_ms, easing);
+}
+
+/**
+* Fades a widget's text colour to another over duration_ms.
+*/
+void animate_color(Widget w, const Rocket::Core::Colourb& to, int duration_ms, int easing = EASE_LINEAR)
+{
+	float value[4] = { (float)to.red, (float)to.green, (float)to.blue, (float)to.alpha };
+	_tween_start(w, ANIM_COLOR, value, 4, duration_ms, easing);
+}
+
+/**
+* Stops a widget's animations where they are.
+*/
+void stop_animation(Widget w)
+{
+	struct winstate* window = _window_of(w);
+
+	for (size_t i = 0; i < window->tweens.size();)
+	{
+		if (window->tweens[i].w == w)
+		{
+			w->RemoveReference();
+			window->tweens[i] = window->tweens.back();
+			window->tweens.pop_back();
+		}
+		else
+			i++;
+	}
+}
+
+/**
+* The current window's running animations, and the average time per frame
+* spent advancing them, in milliseconds per thousand animations.
+*/
+void get_tween_stats(int* active, float* ms_per_thousand)
+{
+	struct winstate* window = GetWindowState();
+	*active = (int)window->tweens.size();
+	*ms_per_thousand = window->tween_count > 0 ? (float)(window->tween_ticks * 1000.0 * 1000.0 / SDL_GetPerformanceFrequency() / window->tween_count) : 0;
+}
+
+
+// immediate-mode drawing
+//
+// draw_rect(), draw_image() and draw_text() don't create widgets. They are
+// recorded into the current window's draw buffers and drawn over the
+// document the next time it renders, then forgotten; call them every frame
+// for as long as something should be visible. Primitives are sorted by layer
+// and then by texture, and each run that shares both is one draw call.
+
+/**
+* Reserves room for one primitive and returns it; its vertices and indices
+* are written at first_vertex and first_index.
+*/
+static _draw_primitive& _draw_begin(struct winstate* window, int layer, Rocket::Core::TextureHandle texture, unsigned int num_vertices, unsigned int num_indices)
+{
+	_draw_primitive primitive;
+	primitive.layer = layer;
+	primitive.texture = texture;
+	primitive.order = window->draw_primitives.size();
+	primitive.first_vertex = (unsigned int)window->draw_vertices.size();
+	primitive.num_vertices = num_vertices;
+	primitive.first_index = (unsigned int)window->draw_indices.size();
+	primitive.num_indices = num_indices;
+
+	window->draw_vertices.resize(window->draw_vertices.size() + num_vertices);
+	window->draw_indices.resize(window->draw_indices.size() + num_indices);
+	window->draw_primitives.push_back(primitive);
+	return window->draw_primitives.back();
+}
+
+/**
+* Draws a filled rectangle this frame.
+*/
+void draw_rect(float x, float y, float w, float h, const Rocket::Core::Colourb& colour, int layer = 0)
+{
+	struct winstate* window = GetWindowState();
+	_draw_primitive& p = _draw_begin(window, layer, 0, 4, 6);
+
+	Rocket::Core::GeometryUtilities::GenerateQuad(&window->draw_vertices[p.first_vertex], &window->draw_indices[p.first_index],
+		Rocket::Core::Vector2f(x, y), Rocket::Core::Vector2f(w, h), colour);
+}
+
+/**
+* Draws an image this frame. A width or height of 0 uses the image's own.
+* Images are loaded the first time they are drawn and kept for the window's
+* lifetime.
+*/
+void draw_image(const char* file, float x, float y, float w = 0, float h = 0, int layer = 0)
+{
+	struct winstate* window = GetWindowState();
+
+	Rocket::Core::Texture*& texture = window->draw_textures[file];
+	if (texture == NULL)
+	{
+		texture = new Rocket::Core::Texture;
+		texture->Load(file);
+	}
+
+	Rocket::Core::TextureHandle handle = texture->GetHandle(window->rrenderer);
+	if (!handle)
+		return;
+
+	if (w <= 0 || h <= 0)
+	{
+		Rocket::Core::Vector2i dimensions = texture->GetDimensions(window->rrenderer);
+		w = w > 0 ? w : (float)dimensions.x;
+		h = h > 0 ? h : (float)dimensions.y;
+	}
+
+	_draw_primitive& p = _draw_begin(window, layer, handle, 4, 6);
+
+	Rocket::Core::GeometryUtilities::GenerateQuad(&window->draw_vertices[p.first_vertex], &window->draw_indices[p.first_index],
+		Rocket::Core::Vector2f(x, y), Rocket::Core::Vector2f(w, h), Rocket::Core::Colourb(255, 255, 255, 255),
+		Rocket::Core::Vector2f(0, 0), Rocket::Core::Vector2f(1, 1));
+}
+
+/**
+* Draws a line of text this frame with its top left corner at (x, y). style
+* is 0 or FONT_BOLD/FONT_ITALIC flags; the font must have been loaded with
+* load_font(). Returns the width of the text in pixels.
+*/
+int draw_text(const char* text, float x, float y, int size, const Rocket::Core::Colourb& colour, int style = 0, int layer = 0, const char* font = DEFAULT_FONT)
+{
+	struct winstate* window = GetWindowState();
+
+	std::string key = std::string(font) + '/' + std::to_string(size) + '/' + std::to_string(style);
+	std::unordered_map<std::string, Rocket::Core::FontFaceHandle*>::iterator it = window->draw_fonts.find(key);
+	if (it == window->draw_fonts.end())
+	{
+		Rocket::Core::FontFaceHandle* handle = Rocket::Core::FontDatabase::GetFontFaceHandle(font, "U+0020-007E",
+			style & FONT_ITALIC ? Rocket::Core::Font::STYLE_ITALIC : Rocket::Core::Font::STYLE_NORMAL,
+			style & FONT_BOLD ? Rocket::Core::Font::WEIGHT_BOLD : Rocket::Core::Font::WEIGHT_NORMAL, size);
+		it = window->draw_fonts.insert(std::make_pair(key, handle)).first;
+	}
+
+	Rocket::Core::FontFaceHandle* handle = it->second;
+	if (handle == NULL)
+		return 0;
+
+	// one piece of geometry per font texture
+	Rocket::Core::GeometryList geometry;
+	Rocket::Core::Vector2f baseline(x, y + (float)(handle->GetLineHeight() - handle->GetBaseline()));
+	int width = handle->GenerateString(geometry, Rocket::Core::WString(Rocket::Core::String(text)), baseline, colour);
+
+	for (size_t i = 0; i < geometry.size(); i++)
+	{
+		std::vector<Rocket::Core::Vertex>& vertices = geometry[i].GetVertices();
+		std::vector<int>& indices = geometry[i].GetIndices();
+		if (indices.empty())
+			continue;
+
+		const Rocket::Core::Texture* texture = geometry[i].GetTexture();
+		Rocket::Core::TextureHandle texture_handle = texture != NULL ? texture->GetHandle(window->rrenderer) : 0;
+
+		_draw_primitive& p = _draw_begin(window, layer, texture_handle, (unsigned int)vertices.size(), (unsigned int)indices.size());
+		std::copy(vertices.begin(), vertices.end(), window->draw_vertices.begin() + p.first_vertex);
+		std::copy(indices.begin(), indices.end(), window->draw_indices.begin() + p.first_index);
+	}
+
+	return width;
+}
+
+/**
+* Renders and clears a window's immediate-mode primitives. Called right after
+* the window's context has rendered.
+*/
+static void _render_draw_batch(struct winstate* window)
+{
+	std::vector<_draw_primitive>& primitives = window->draw_primitives;
+	if (primitives.empty())
+		return;
+
+	std::sort(primitives.begin(), primitives.end(), [](const _draw_primitive& a, const _draw_primitive& b)
+	{
+		if (a.layer != b.layer)
+			return a.layer < b.layer;
+		if (a.texture != b.texture)
+			return a.texture < b.texture;
+		return a.order < b.order;
+	});
+
+	window->rrenderer->EnableScissorRegion(false);
+
+	std::vector<Rocket::Core::Vertex>& vertices = window->draw_batch_vertices;
+	std::vector<int>& indices = window->draw_batch_indices;
+
+	for (size_t i = 0; i < primitives.size();)
+	{
+		// merge the run of primitives that share a layer and a texture
+		vertices.clear();
+		indices.clear();
+
+		size_t end = i;
+		for (; end < primitives.size() && primitives[end].layer == primitives[i].layer && primitives[end].texture == primitives[i].texture; end++)
+		{
+			const _draw_primitive& p = primitives[end];
+			int base = (int)vertices.size();
+
+			vertices.insert(vertices.end(), window->draw_vertices.begin() + p.first_vertex, window->draw_vertices.begin() + p.first_vertex + p.num_vertices);
+			for (unsigned int j = 0; j < p.num_indices; j++)
+				indices.push_back(window->draw_indices[p.first_index + j] + base);
+		}
+
+		window->rrenderer->RenderGeometry(&vertices[0], (int)vertices.size(), &indices[0], (int)indices.size(), primitives[i].texture, Rocket::Core::Vector2f(0, 0));
+		i = end;
+	}
+
+	// clear() keeps the capacity, so steady state frames don't allocate
+	primitives.clear();
+	window->draw_vertices.clear();
+	window->draw_indices.clear();
+}
+
+/**
+* Sets the widget's width in pixels
+*/
+void set_width(Widget w, int v)
+{
+	set<Width>(w, (float)v, PX);
+}
+
+/**
+* Sets the widget's height in pixels
+*/
+void set_height(Widget w, int v)
+{
+	set<Height>(w, (float)v, PX);
+}
+
+/**
+* Sets the widget's text to center
+*/
+void set_text_center(Widget w)
+{
+	set_keyword<TextAlign>(w, Rocket::Core::TEXT_ALIGN_CENTER);
+}
+
+/**
+ * Puts text with no markup straight into the widget's text node, instead of
+ * parsing it and replacing the node. Returns false if the widget holds
+ * anything but a single text node, so the caller falls back to RML.
+ */
+static bool _set_plain_text(Widget w, const char* text)
+{
+	// tags and entities need the parser
+	if (strpbrk(text, "<&") != NULL)
+		return false;
+
+	int children = w->GetNumChildren();
+	if (children == 0)
+	{
+		if (text[0] != 0)
+		{
+			// an unparented widget (staged, detached, not yet attached) has no owner document
+			Rocket::Core::ElementText* node = _window_of(w)->document->CreateTextNode(text);
+			w->AppendChild(node);
+			node->RemoveReference();
+		}
+		return true;
+	}
+
+	Rocket::Core::ElementText* node = children == 1 ? dynamic_cast<Rocket::Core::ElementText*>(w->GetFirstChild()) : NULL;
+	if (node == NULL)
+		return false;
+
+	// the node's string is assigned in place, keeping its buffer, and its
+	// glyphs are regenerated the next time the line is laid out
+	Rocket::Core::WString wtext(text);
+	if (!(node->GetText() == wtext))
+		node->SetText(wtext);
+
+	return true;
+}
+
+/**
+* Changes the text of the widget
+*/
+void set_text(Widget w, const char* text)
+{
+	// children attached earlier in a batch are there to be replaced, as they would be unbatched
+	if (_window_of(w)->batch_depth > 0)
+		_append_staged_children(w);
+
+	if (w->GetTagName() == "input" && w->GetAttribute("type")->Get<Rocket::Core::String>() == "text")
+		((Rocket::Controls::ElementFormControlInput*)w)->SetValue(text);
+	// define MINGUI_REPARSE_TEXT to send all text through the parser, e.g. to compare timings
+#ifndef MINGUI_REPARSE_TEXT
+	else if (_set_plain_text(w, text))
+		return;
+#endif
+	else
+	{
+		w->SetInnerRML(text);
+		_index_subtree(w);
+	}
+}
+
+
+enum { BIND_INT, BIND_FLOAT, BIND_STRING };
+
+/**
+ * Reads a bound value's current bytes.
+ */
+static void _binding_bytes(const _binding& binding, std::string& bytes)
+{
+	switch (binding.type)
+	{
+	case BIND_INT:		bytes.assign((const char*)binding.value, sizeof(int)); break;
+	case BIND_FLOAT:	bytes.assign((const char*)binding.value, sizeof(float)); break;
+	default:			bytes.assign((const char*)binding.value); break;
+	}
+}
+
+/**
+ * Pushes a binding's value to its widget.
+ */
+static void _apply_binding(const _binding& binding)
+{
+	if (binding.property.Empty())
+	{
+		Rocket::Core::String text;
+		switch (binding.type)
+		{
+		case BIND_INT:		text = Rocket::Core::String(256, binding.format.c_str(), *(const int*)binding.value); break;
+		case BIND_FLOAT:	text = Rocket::Core::String(256, binding.format.c_str(), *(const float*)binding.value); break;
+		default:			text = Rocket::Core::String(256, binding.format.c_str(), (const char*)binding.value); break;
+		}
+
+		set_text(binding.w, text.CString());
+	}
+	else
+	{
+		float value = binding.type == BIND_INT ? (float)*(const int*)binding.value : *(const float*)binding.value;
+		_set_property(binding.w, binding.property, Rocket::Core::Property(value, binding.unit));
+	}
+}
+
+/**
+ * Applies the bindings whose values changed since they were last applied.
+ */
+static void _apply_bindings(struct winstate* window)
+{
+	struct enstate* enstate = GetEngineState();
+	std::string bytes;
+
+	for (size_t i = 0; i < window->bindings.size(); i++)
+	{
+		_binding& binding = window->bindings[i];
+
+		_binding_bytes(binding, bytes);
+		if (bytes == binding.snapshot)
+		{
+			enstate->bindings_skipped++;
+			continue;
+		}
+
+		binding.snapshot.swap(bytes);
+		_apply_binding(binding);
+		enstate->bindings_applied++;
+	}
+}
+
+static void _bind(Widget w, const void* value, int type, const char* format, const char* property, PropertyUnit unit)
+{
+	_binding binding;
+	binding.w = w;
+	binding.value = value;
+	binding.type = type;
+	binding.format = format != NULL ? format : "";
+	binding.property = property != NULL ? property : "";
+	binding.unit = unit;
+
+	_binding_bytes(binding, binding.snapshot);
+	_apply_binding(binding);
+
+	// hold on to the widget while it is bound
+	w->AddReference();
+	_window_of(w)->bindings.push_back(binding);
+}
+
+/**
+* Binds a widget's text to an int. Every frame, if the int has changed, the
+* text is set to it, formatted with fmt; otherwise the widget is left alone.
+* The int must outlive the binding.
+*/
+void bind_text(Widget w, const int* value, const char* fmt = "%d")
+{
+	_bind(w, value, BIND_INT, fmt, NULL, PX);
+}
+
+/**
+* Binds a widget's text to a float, like bind_text() for ints.
+*/
+void bind_text(Widget w, const float* value, const char* fmt = "%g")
+{
+	_bind(w, value, BIND_FLOAT, fmt, NULL, PX);
+}
+
+/**
+* Binds a widget's text to a string buffer, like bind_text() for ints. The
+* buffer is compared by content, so it can be rewritten in place.
+*/
+void bind_text(Widget w, const char* value, const char* fmt = "%s")
+{
+	_bind(w, value, BIND_STRING, fmt, NULL, PX);
+}
+
+/**
+* Binds a numeric property to an int, e.g. bind_prop(w, "width", &hp, PX) or
+* bind_prop(w, "z-index", &layer, NUMBER). Every frame, if the int has
+* changed, the property is set to it in unit.
+*/
+void bind_prop(Widget w, const char* prop, const int* value, PropertyUnit unit)
+{
+	_bind(w, value, BIND_INT, NULL, prop, unit);
+}
+
+/**
+* Binds a numeric property to a float, like bind_prop() for ints, e.g.
+* bind_prop(w, "opacity", &alpha, NUMBER).
+*/
+void bind_prop(Widget w, const char* prop, const float* value, PropertyUnit unit)
+{
+	_bind(w, value, BIND_FLOAT, NULL, prop, unit);
+}
+
+/**
+* Removes every binding on a widget. Its text and properties keep their
+* last values.
+*/
+void unbind(Widget w)
+{
+	struct winstate* window = _window_of(w);
+
+	for (size_t i = 0; i < window->bindings.size();)
+	{
+		if (window->bindings[i].w == w)
+		{
+			w->RemoveReference();
+			window->bindings.erase(window->bindings.begin() + i);
+		}
+		else
+			i++;
+	}
+}
+
+/**
+* How many binding checks found a changed value and updated the widget, and
+* how many found it unchanged and skipped it, since startup.
+*/
+void get_binding_stats(int* applied, int* skipped)
+{
+	struct enstate* enstate = GetEngineState();
+	*applied = enstate->bindings_applied;
+	*skipped = enstate->bindings_skipped;
+}
+
+/**
+* Creates a button
+*/
+Widget create_button(const char* text)
+{
+	struct winstate* window = GetWindowState();
+	Rocket::Core::Element* new_element = _create_element(window, "button", text);
+	_attach(new_element, NULL);
+	return new_element;
+}
+
+/**
+* Exits the game. 
+*/
+void exit_game()
+{
+	struct enstate* enstate = GetEngineState();
+	enstate->exit = true;
+}
+
+/**
+* Binds an event. 
+*/
+void bind_event(Widget w, const char* name, basic_event_ptr e)
+{
+	_Listener::Get(e)->Bind(w, name);
+}
+
+/**
+* Handles an event for every descendant of container that matches selector:
+* "#id", ".class" or a tag name. Only one listener is added to the container
+* however many widgets and selectors are handled. The handler is passed the
+* matching widget.
+*/
+void delegate_event(Widget container, const char* name, const char* selector, basic_event_ptr e)
+{
+	_DelegateListener* l = _DelegateListener::Get(container);
+	if (l->Add(name, selector, e))
+		container->AddEventListener(name, l);
+}
+
+/**
+* Calls on_down when a key is pressed and on_up when it is released; either
+* may be NULL. Callbacks run as the key events arrive, not every frame.
+* repeat_ms controls what happens while the key is held: KEY_NO_REPEAT
+* ignores repeats, KEY_OS_REPEAT passes on the operating system's repeats,
+* and a positive value repeats on_down at that interval instead. Binding a
+* key again replaces its callbacks.
+*/
+void bind_key(SDL_Keycode key, key_event_ptr on_down, key_event_ptr on_up = NULL, int repeat_ms = KEY_NO_REPEAT)
+{
+	std::vector<_key_binding>& bindings = GetEngineState()->key_bindings;
+
+	_key_binding binding;
+	binding.key = key;
+	binding.on_down = on_down;
+	binding.on_up = on_up;
+	binding.repeat_ms = repeat_ms;
+	binding.held = false;
+	binding.next_repeat = 0;
+
+	for (size_t i = 0; i < bindings.size(); i++)
+		if (bindings[i].key == key)
+		{
+			bindings[i] = binding;
+			return;
+		}
+
+	bindings.push_back(binding);
+}
+
+/**
+* Removes a key's callbacks.
+*/
+void unbind_key(SDL_Keycode key)
+{
+	std::vector<_key_binding>& bindings = GetEngineState()->key_bindings;
+
+	for (size_t i = 0; i < bindings.size(); i++)
+		if (bindings[i].key == key)
+		{
+			bindings.erase(bindings.begin() + i);
+			return;
+		}
+}
+
+static _key_binding* _find_key_binding(SDL_Keycode key)
+{
+	std::vector<_key_binding>& bindings = GetEngineState()->key_bindings;
+
+	for (size_t i = 0; i < bindings.size(); i++)
+		if (bindings[i].key == key)
+			return &bindings[i];
+
+	return NULL;
+}
+
+/**
+* Runs key callbacks for a key press or release.
+*/
+static void _dispatch_key(const SDL_KeyboardEvent& event)
+{
+	_key_binding* binding = _find_key_binding(event.keysym.sym);
+	if (binding == NULL)
+		return;
+
+	// copied, as a callback may rebind keys
+	key_event_ptr on_down = binding->on_down;
+	key_event_ptr on_up = binding->on_up;
+	SDL_Keycode key = binding->key;
+
+	if (event.type == SDL_KEYUP)
+	{
+		binding->held = false;
+		if (on_up != NULL)
+			on_up(key, false);
+		return;
+	}
+
+	if (event.repeat)
+	{
+		if (binding->repeat_ms == KEY_OS_REPEAT && on_down != NULL)
+			on_down(key, true);
+		return;
+	}
+
+	binding->held = true;
+	binding->next_repeat = GetEngineState()->rsi->GetElapsedTime() + binding->repeat_ms / 1000.0f;
+	if (on_down != NULL)
+		on_down(key, false);
+}
+
+/**
+* Synthesizes repeats for held keys bound with a repeat interval.
+*/
+static void _repeat_keys()
+{
+	struct enstate* enstate = GetEngineState();
+	std::vector<_key_binding>& bindings = enstate->key_bindings;
+	float now = enstate->rsi->GetElapsedTime();
+
+	for (size_t i = 0; i < bindings.size(); i++)
+	{
+		_key_binding& binding = bindings[i];
+		if (!binding.held || binding.repeat_ms <= 0 || now < binding.next_repeat)
+			continue;
+
+		binding.next_repeat = now + binding.repeat_ms / 1000.0f;
+		if (binding.on_down != NULL)
+		{
+			key_event_ptr on_down = binding.on_down;
+			on_down(binding.key, true);
+
+			// the callback may have changed the bindings
+			if (i >= bindings.size())
+				break;
+		}
+	}
+}
+
+/**
+* Gets a property from an event.
+*/
+template<typename T>
+void get_event_value(WidgetEvent e, const char* prop, T defaultValue)
+{
+	return e.GetParameter(prop, defaultValue);
+}
+
+/**
+* Creates the desired element and optionally automatically adds it to the DOM.
+*/
+Widget create(const char* e, bool autoAdd = true)
+{
+	Rocket::Core::Element* E = _create_element(GetWindowState(), e);
+	if (autoAdd)
+		_attach(E, NULL);
+	return E;
+}
+
+/**
+* Creates an unparented container
+*/
+Widget create_container(bool autoAttach = true)
+{
+	return create("div", autoAttach);
+}
+
+/**
+* Parents an element to another element
+*/
+void attach(Widget subnode, Widget parentnode)
+{
+	_attach(subnode, parentnode);
+	_index_subtree(subnode);
+}
+
+/**
+* Parents an element to the root node
+*/
+void attach(Widget subnode)
+{
+	_attach(subnode, NULL);
+	_index_subtree(subnode);
+}
+
+// destruction and pooling
+//
+// destroy() strips an element back to what create() would return and keeps
+// it for the next create() of the same tag, so spawning and despawning
+// widgets doesn't allocate. A pooled element keeps a lone text node, which
+// the next create_text() or create_button() rewrites instead of allocating
+// another. Only plain elements are pooled; form controls and mingui's own
+// elements hold state that clearing attributes and properties doesn't
+// reset, so they are released.
+
+static const size_t MaxPooledPerTag = 256;
+
+static bool _poolable(const Rocket::Core::String& tag)
+{
+	return tag == "div" || tag == "p" || tag == "span" || tag == "button" || tag == "img";
+}
+
+/**
+* Drops everything mingui keeps about a widget: translation, bindings,
+* pending updates, index entries and event handlers.
+*/
+static void _forget(struct winstate* window, Widget w)
+{
+	int slot = _translation_slot(window, w);
+	if (slot >= 0)
+		_remove_translation(window, slot);
+
+	unbind(w);
+	stop_animation(w);
+
+	for (size_t i = 0; i < window->dirty_widgets.size();)
+	{
+		if (window->dirty_widgets[i].first == w)
+			window->dirty_widgets.erase(window->dirty_widgets.begin() + i);
+		else
+			i++;
+	}
+
+	for (size_t i = 0; i < window->batch_properties.size();)
+	{
+		if (window->batch_properties[i].w == w)
+			window->batch_properties.erase(window->batch_properties.begin() + i);
+		else
+			i++;
+	}
+
+	for (size_t i = 0; i < window->batch_attachments.size();)
+	{
+		if (window->batch_attachments[i].first == w || window->batch_attachments[i].second == w)
+			window->batch_attachments.erase(window->batch_attachments.begin() + i);
+		else
+			i++;
+	}
+
+	// removing the index listener unindexes the element
+	if (window->indexed.find(w) != window->indexed.end())
+		w->RemoveEventListener("mingui-index", _IndexListener::Get());
+
+	_Listener::Release(w);
+	_DelegateListener::Release(w);
+}
+
+/**
+* Clears an element's properties, attributes and state.
+*/
+static void _reset(Widget w)
+{
+	std::vector<Rocket::Core::String> names;
+
+	const Rocket::Core::PropertyMap* properties = w->GetLocalProperties();
+	if (properties != NULL)
+		for (Rocket::Core::PropertyMap::const_iterator it = properties->begin(); it != properties->end(); ++it)
+			names.push_back(it->first);
+
+	for (size_t i = 0; i < names.size(); i++)
+		w->RemoveProperty(names[i]);
+
+	names.clear();
+
+	int index = 0;
+	Rocket::Core::String name, value;
+	while (w->IterateAttributes(index, name, value))
+		names.push_back(name);
+
+	// this includes id and class
+	for (size_t i = 0; i < names.size(); i++)
+		w->RemoveAttribute(names[i]);
+
+	static const char* pseudo_classes[] = { "hover", "active", "focus", "checked" };
+	for (size_t i = 0; i < sizeof(pseudo_classes) / sizeof(pseudo_classes[0]); i++)
+		w->SetPseudoClass(pseudo_classes[i], false);
+
+	w->SetScrollLeft(0);
+	w->SetScrollTop(0);
+}
+
+static void _destroy(struct winstate* window, Widget w)
+{
+	std::vector<Rocket::Core::Element*>& pool = window->pools[w->GetTagName().CString()];
+	bool pooled = _poolable(w->GetTagName()) && pool.size() < MaxPooledPerTag;
+
+	int keep = pooled && w->GetNumChildren() == 1 && dynamic_cast<Rocket::Core::ElementText*>(w->GetFirstChild()) != NULL ? 1 : 0;
+	while (w->GetNumChildren() > keep)
+		_destroy(window, w->GetChild(w->GetNumChildren() - 1));
+
+	_forget(window, w);
+
+	// the reference we keep: an unparented element's own, or a new one
+	if (window->detached.erase(w) == 0)
+		w->AddReference();
+
+	Widget parent = w->GetParentNode();
+	if (parent != NULL)
+		parent->RemoveChild(w);
+
+	// the children may have filled the pool meanwhile
+	if (pooled && pool.size() < MaxPooledPerTag)
+	{
+		_reset(w);
+		pool.push_back(w);
+	}
+	else
+		w->RemoveReference();
+}
+
+/**
+* Removes a widget and everything in it from the screen for good. The
+* widgets' handlers, bindings and styles are dropped, and plain ones are kept
+* to be handed out again by later create_* calls, so don't use w afterwards.
+*/
+void destroy(Widget w)
+{
+	_destroy(_window_of(w), w);
+}
+
+/**
+* Takes a widget off the screen without destroying it. It keeps its children,
+* handlers and styles; put it back with attach(), or destroy() it.
+*/
+void detach(Widget w)
+{
+	struct winstate* window = _window_of(w);
+
+	Widget parent = w->GetParentNode();
+	if (parent == NULL || window->detached.count(w) > 0)
+		return;
+
+	// keep it alive until it is attached again
+	w->AddReference();
+	window->detached.insert(w);
+	parent->RemoveChild(w);
+}
+
+/**
+* Creates a tab control
+*/
+Widget create_tabs_container()
+{
+	return create("tabset");
+}
+
+/**
+* Adds a tab to a tab control
+*/
+Widget create_tab(Widget tabset, const char* title, Widget content)
+{
+	struct winstate* window = GetWindowState();
+
+	Rocket::Controls::ElementTabSet* tab = (Rocket::Controls::ElementTabSet*)window->document->CreateElement("tab");
+	tab->SetInnerRML(title);
+	tabset->AppendChild(tab);
+	tab->RemoveReference();
+
+	Rocket::Core::Element* panel = window->document->CreateElement("panel");
+	panel->AppendChild(content);
+	tabset->AppendChild(panel);
+	panel->RemoveReference();
+	
+	return tab;
+}
+
+/**
+* Sets a widget's property
+*/
+inline void set_prop(Widget w, const char* prop, const char* val)
+{
+	_set_property(w, prop, val);
+}
+
+/**
+* Loads a document. Parsed documents are cached next to the file as
+* <file>.cache and rebuilt from there while the RML and RCSS are unchanged;
+* parse and instantiate times are logged.
+*/
+void load_document(const char* file)
+{
+	struct winstate* window = GetWindowState();
+	window->context->UnloadAllDocuments();
+	window->document = DocumentCache::Load(window->context, file);
+
+	window->id_misses.clear();
+
+	if (window->document != NULL)
+	{
+		_init_document_style(window);
+		_index_subtree(window->document);
+	}
+}
+
+/**
+* Creates a form element
+*/
+Widget create_form(const char* type)
+{
+	Widget w = create("input");
+	w->SetAttribute("type", type);
+	return w;
+}
+
+/**
+* Creates an image element
+*/
+Widget create_image(const char* file)
+{
+	Widget w = create("img");
+	w->SetAttribute("src", file);
+	return w;
+}
+
+/**
+* Creates a tile map: a cols x rows grid of cell_w x cell_h pixel cells drawn
+* from an atlas image in a single draw call. tile_w and tile_h give the size
+* of a tile in the atlas if it differs from the cell size. All cells start
+* empty; fill them with set_tile().
+*/
+Widget create_tilemap(int cols, int rows, int cell_w, int cell_h, const char* atlas, int tile_w = 0, int tile_h = 0)
+{
+	Widget w = create("tilemap");
+	((ElementTileMap*)w)->Initialise(cols, rows, cell_w, cell_h, atlas, tile_w, tile_h);
+	return w;
+}
+
+/**
+* Sets the tile at cell (x, y) of a tile map. Tile ids count atlas tiles left
+* to right, top to bottom, starting at 0; -1 empties the cell.
+*/
+void set_tile(Widget tilemap, int x, int y, int tile_id)
+{
+	((ElementTileMap*)tilemap)->SetTile(x, y, tile_id);
+}
+
+/**
+* Creates an animated sprite from a sheet of cols x rows equally sized
+* frames, numbered left to right, top to bottom. It plays every frame in
+* turn at fps frames per second, looping. Animating never reloads the image
+* or moves other widgets, and sprites from the same sheet share its texture.
+*/
+Widget create_sprite(const char* sheet, int cols, int rows, float fps)
+{
+	Widget w = create("sprite");
+	((ElementSprite*)w)->Initialise(sheet, cols, rows, fps);
+	return w;
+}
+
+/**
+* Makes a sprite loop over count frames starting at first, from the start.
+* With fps 0 it holds on first.
+*/
+void set_sprite_animation(Widget sprite, int first, int count, float fps)
+{
+	((ElementSprite*)sprite)->SetAnimation(first, count, fps);
+}
+
+/**
+* Creates a canvas: a w x h image whose pixels the program writes directly.
+* Write through get_canvas_pixels(), then report what changed with
+* canvas_mark_dirty(); only the marked rectangles are sent to the GPU, once
+* per frame.
+*/
+Widget create_canvas(int w, int h)
+{
+	Widget canvas = create("canvas");
+	((ElementCanvas*)canvas)->Initialise(w, h);
+	return canvas;
+}
+
+/**
+* Returns a canvas's pixels: h rows of w pixels, top to bottom, each pixel
+* four bytes in R, G, B, A order. They start transparent black.
+*/
+unsigned char* get_canvas_pixels(Widget canvas)
+{
+	return ((ElementCanvas*)canvas)->GetPixels();
+}
+
+/**
+* Marks a rectangle of a canvas as changed, to be uploaded next frame.
+* Pixels written but not marked may not appear.
+*/
+void canvas_mark_dirty(Widget canvas, int x, int y, int w, int h)
+{
+	((ElementCanvas*)canvas)->MarkDirty(x, y, w, h);
+}
+
+/**
+* Creates a scrolling list of count rows, each item_height pixels tall, that
+* only builds elements for the rows in view. fill is called with a row widget
+* and the index it now shows whenever a row comes into view; set its text or
+* children there. Give the list a height with set_height().
+*/
+Widget create_virtual_list(int item_height, int count, list_fill_ptr fill)
+{
+	Widget w = create("virtuallist");
+	((ElementVirtualList*)w)->Initialise(item_height, count, fill);
+	return w;
+}
+
+/**
+* Changes the number of rows in a virtual list. Rows in view are filled again.
+*/
+void set_virtual_list_count(Widget list, int count)
+{
+	((ElementVirtualList*)list)->SetCount(count);
+}
+
+/**
+* Fills the rows in view again, for when the data they show has changed.
+*/
+void refresh_virtual_list(Widget list)
+{
+	((ElementVirtualList*)list)->Refresh();
+}
+
+/**
+* Sets layering
+*/
+void set_layer(Widget w, int layer)
+{
+	set<ZIndex>(w, (float)layer, NUMBER);
+}
+
+/**
+* Sets attribute
+*/
+void set_attribute(Widget w, const char* k, const char* v)
+{
+	w->SetAttribute(k, v);
+
+	if (!strcmp(k, "id") || !strcmp(k, "class"))
+		_index(w);
+}
+
+/**
+* Gets attribute
+*/
+const char* get_attribute(Widget w, const char* k)
+{
+	return w->GetAttribute(k)->Get<Rocket::Core::String>().CString();
+}
+
+/**
+* Gets the class of a widget
+*/
+const char* get_widget_class(Widget w)
+{
+	// GetClassNames() returns a temporary; keep it alive until the next call
+	static Rocket::Core::String classes;
+	classes = w->GetClassNames();
+	return classes.CString();
+}
+
+/**
+* Sets the class of a widget
+*/
+const char* set_widget_class(Widget w, const char* classes)
+{
+	w->SetClassNames(classes);
+	_index(w);
+	return classes;
+}
+
+/**
+* Gets a widget by id
+*/
+Widget get_widget_by_id(const char* id)
+{
+	struct winstate* window = GetWindowState();
+
+	std::unordered_map<std::string, Rocket::Core::Element*>::iterator it = window->id_index.find(id);
+	if (it != window->id_index.end() && it->second->GetId() == id)
+		return it->second;
+
+	if (window->id_misses.count(id) > 0)
+		return NULL;
+
+	// not set through mingui; look it up once and remember it, or that it isn't there
+	Widget w = window->document->GetElementById(id);
+	if (w != NULL)
+		_index(w);
+	else
+		window->id_misses.insert(id);
+
+	return w;
+}
+
+/**
+* Gets the widgets that have a class. Fills up to max widgets into out and
+* returns how many there are in total.
+*/
+int get_widgets_by_class(const char* name, Widget* out, int max)
+{
+	struct winstate* window = GetWindowState();
+
+	std::unordered_map<std::string, std::vector<Rocket::Core::Element*> >::iterator it = window->class_index.find(name);
+	if (it == window->class_index.end())
+		return 0;
+
+	int count = 0;
+	for (size_t i = 0; i < it->second.size(); i++)
+	{
+		if (count < max)
+			out[count] = it->second[i];
+		count++;
+	}
+
+	return count;
+}
+
+/**
+* Gets the current window's root node, e.g. to delegate events for the whole window
+*/
+Widget get_root()
+{
+	return GetWindowState()->document;
+}
+
+/**
+* Gets a child
+*/
+inline Widget get_child(Widget w, int idx)
+{
+	return w->GetChild(idx);
+}
+
+/**
+* Gets the widget's id
+*/
+const char* get_id(Widget w)
 {
-	w->SetProperty("position", "absolute");
-	w->SetProperty("margin", Rocket::Core::String(100, "%dpx %dpx", y, x).CString());
+	return w->GetId().CString();
 }
 
+// Element::DirtyLayout() is protected; a member pointer taken through a
+// derived class is the legal way to reach it from outside.
+struct _ElementAccess : public Rocket::Core::Element
+{
+	static void dirty_layout(Rocket::Core::Element* e)
+	{
+		void (Rocket::Core::Element::*fn)() = &_ElementAccess::DirtyLayout;
+		(e->*fn)();
+	}
+};
+
 /**
-* Sets the widget's width in pixels
+* Marks a widget and its children dirty. flags is any of:
+*
+*  INVALIDATE_STYLE: their style sheet rules are matched again at the next
+*  update, as after a class change.
+*  INVALIDATE_LAYOUT: the document is laid out again.
+*  INVALIDATE_GEOMETRY: backgrounds, borders and text are rebuilt for the
+*  colours set on the widgets themselves (set_background_color() and the
+*  like outside a batch). Colours that come from style sheets or shared
+*  style classes aren't touched; libRocket rebuilds those when they change.
+*
+* Nothing happens until flush_updates(), which the main loop also calls
+* before every update.
 */
-void set_width(Widget w, int v)
+void invalidate(Widget w, int flags = INVALIDATE_ALL)
 {
-	w->SetProperty("width", Rocket::Core::String(100, "%dpx", v).CString());
+	std::vector<std::pair<Rocket::Core::Element*, int> >& dirty = _window_of(w)->dirty_widgets;
+
+	for (size_t i = 0; i < dirty.size(); i++)
+		if (dirty[i].first == w)
+		{
+			dirty[i].second |= flags;
+			return;
+		}
+
+	dirty.push_back(std::make_pair(w, flags));
 }
 
 /**
-* Sets the widget's height in pixels
+* Re-sets a locally set property to the value it already has, which makes
+* libRocket rebuild whatever depends on it.
 */
-void set_height(Widget w, int v)
+static void _touch_local_property(Widget w, const Rocket::Core::String& name)
 {
-	w->SetProperty("height", Rocket::Core::String(100, "%dpx", v).CString());
+	const Rocket::Core::Property* p = w->GetLocalProperty(name);
+	if (p != NULL)
+		w->SetProperty(name, Rocket::Core::Property(*p));
 }
 
-/**
-* Sets the widget's text to center
-*/
-void set_text_center(Widget w)
+static int _invalidate_subtree(Widget w, int flags)
 {
-	w->SetProperty("text-align", "center");
+	static const Rocket::Core::String dirty_class("mingui-dirty");
+
+	if (flags & INVALIDATE_STYLE)
+	{
+		// a class change dirties the element's definition, whether or not a
+		// rule names the class; a pseudo-class change only re-reads the
+		// properties rules give that pseudo-class
+		w->SetClass(dirty_class, true);
+		w->SetClass(dirty_class, false);
+	}
+
+	if (flags & INVALIDATE_GEOMETRY)
+	{
+		_touch_local_property(w, BackgroundColor::name());
+		_touch_local_property(w, BorderTopColor::name());
+		_touch_local_property(w, BorderRightColor::name());
+		_touch_local_property(w, BorderBottomColor::name());
+		_touch_local_property(w, BorderLeftColor::name());
+		_touch_local_property(w, Color::name());
+	}
+
+	int touched = 1;
+	for (int i = 0; i < w->GetNumChildren(); i++)
+		touched += _invalidate_subtree(w->GetChild(i), flags);
+
+	return touched;
 }
 
 /**
-* Changes the text of the widget
+* Processes one window's invalidations; see flush_updates().
 */
-void set_text(Widget w, const char* text)
+static int _flush_window(struct winstate* window)
 {
-	if (w->GetTagName() == "input" && w->GetAttribute("type")->Get<Rocket::Core::String>() == "text")
-		((Rocket::Controls::ElementFormControlInput*)w)->SetValue(text);
-	else
-		w->SetInnerRML(text);
-}
+	std::vector<std::pair<Rocket::Core::Element*, int> >& dirty = window->dirty_widgets;
+
+	int touched = 0;
+	bool layout = false;
+
+	for (size_t i = 0; i < dirty.size(); i++)
+	{
+		Widget w = dirty[i].first;
+		int flags = dirty[i].second;
+
+		if (flags & (INVALIDATE_STYLE | INVALIDATE_GEOMETRY))
+			touched += _invalidate_subtree(w, flags);
+		else
+			touched++;
+
+		if (flags & INVALIDATE_LAYOUT)
+		{
+			_ElementAccess::dirty_layout(w);
+			layout = true;
+		}
+	}
+
+	// clear() keeps the capacity, so steady state flushes don't allocate
+	dirty.clear();
 
+	if (layout && window->batch_depth == 0)
+		window->document->UpdateLayout();
+
+	return touched;
+}
 
 /**
-* Creates a button
+* Processes everything passed to invalidate() since the last flush and
+* returns how many elements were touched. Only the invalidated subtrees are
+* visited, and a document is laid out only if layout was invalidated in it.
 */
-Widget create_button(const char* text)
+int flush_updates()
 {
 	struct enstate* enstate = GetEngineState();
-	Rocket::Core::Element* new_element = enstate->document->CreateElement("button");
-	
-	// default font
-	new_element->SetProperty("font-family", DEFAULT_FONT);
 
-	Rocket::Core::ElementText* new_text_element = enstate->document->CreateTextNode(text);
+	int touched = 0;
+	for (size_t i = 0; i < enstate->windows.size(); i++)
+		touched += _flush_window(enstate->windows[i]);
 
-	new_element->AppendChild(new_text_element);
-	enstate->document->AppendChild(new_element);
-	return new_element;
+	enstate->last_flush_touched = touched;
+	return touched;
 }
 
 /**
-* Exits the game. 
+* How many elements the last flush_updates() touched.
 */
-void exit_game()
+int get_last_flush_count()
 {
-	struct enstate* enstate = GetEngineState();
-	enstate->exit = true;
+	return GetEngineState()->last_flush_touched;
 }
 
 /**
-* Binds an event. 
+* Forces DOM to refresh
 */
-void bind_event(Widget w, const char* name, basic_event_ptr e)
+void widget_refresh_all()
 {
-	_Listener* l = new _Listener(e);
-	w->AddEventListener(name, l);
+	invalidate(GetWindowState()->document, INVALIDATE_LAYOUT);
+	flush_updates();
 }
 
+
+
+
 /**
-* Gets a property from an event.
+* Runs task(userdata) on a background thread, then done(userdata) on the UI
+* thread during a later frame, before widgets are updated. Only done may
+* touch widgets. Either may be NULL. Tasks run in parallel, in no particular
+* order; make sure userdata isn't shared between tasks that run at once.
 */
-template<typename T>
-void get_event_value(WidgetEvent e, const char* prop, T defaultValue)
+void run_async(task_fn_ptr task, task_fn_ptr done, void* userdata)
 {
-	return e.GetParameter(prop, defaultValue);
+	struct enstate* enstate = GetEngineState();
+	if (enstate->tasks == NULL)
+		enstate->tasks = new TaskPool();
+
+	enstate->tasks->Submit(task, done, userdata);
 }
 
 /**
-* Creates the desired element and optionally automatically adds it to the DOM.
+* Limits how many done callbacks run per frame, so many tasks finishing at
+* once are spread over several frames; ASYNC_UNLIMITED runs them all.
 */
-Widget create(const char* e, bool autoAdd = true)
+void set_async_completions_per_frame(int max)
+{
+	GetEngineState()->async_completions_per_frame = max;
+}
+
+static void _run_async_completions()
 {
 	struct enstate* enstate = GetEngineState();
-	Rocket::Core::Element* E = enstate->document->CreateElement(e);
-	E->SetProperty("font-family", DEFAULT_FONT);
-	if (autoAdd)
-		enstate->document->AppendChild(E);
-	return E;
+	if (enstate->tasks == NULL)
+		return;
+
+	int max = enstate->async_completions_per_frame;
+	enstate->tasks->RunCompletions(max == 0 ? ASYNC_COMPLETIONS_DEFAULT : max);
 }
 
-/**
-* Creates an unparented container
-*/
-Widget create_container(bool autoAttach = true)
+// widget changes from other threads
+//
+// libRocket may only be used from the UI thread. Other threads post changes
+// by widget id into a lock-free queue instead; each frame the UI thread
+// drains it, keeps only the last change of each kind per widget, and
+// applies the rest in one batch.
+
+enum { POST_TEXT, POST_POSITION, POST_TRANSLATION, POST_DONE };
+
+static bool _post(int op, const char* id, const char* text, float x, float y)
 {
-	return create("div", autoAttach);
+	struct enstate* enstate = GetEngineState();
+
+	bool queued = enstate->posts.TryEmplace([op, id, text, x, y](_posted& p)
+	{
+		p.op = op;
+		p.x = x;
+		p.y = y;
+
+		size_t length = strlen(id);
+		if (length > MINGUI_POST_ID_SIZE - 1)
+			length = MINGUI_POST_ID_SIZE - 1;
+		memcpy(p.id, id, length);
+		p.id[length] = 0;
+
+		length = text != NULL ? strlen(text) : 0;
+		if (length > MINGUI_POST_TEXT_SIZE - 1)
+			length = MINGUI_POST_TEXT_SIZE - 1;
+		if (length > 0)
+			memcpy(p.text, text, length);
+		p.text[length] = 0;
+	});
+
+	if (!queued)
+		enstate->posts_dropped++;
+
+	return queued;
 }
 
 /**
-* Parents an element to another element
+* Sets the text of the widget with the given id, from any thread. The change
+* is applied at the start of the next frame; if the text is set again before
+* then, only the last text is applied. Returns false if the queue was full
+* and the change was dropped.
 */
-void attach(Widget subnode, Widget parentnode)
+bool post_set_text(const char* widget_id, const char* text)
 {
-	parentnode->AppendChild(subnode);
+	return _post(POST_TEXT, widget_id, text, 0, 0);
 }
 
 /**
-* Parents an element to the root node
+* set_position() for the widget with the given id, from any thread, like
+* post_set_text().
 */
-void attach(Widget subnode)
+bool post_set_position(const char* widget_id, int x, int y)
 {
-	GetEngineState()->document->AppendChild(subnode);
+	return _post(POST_POSITION, widget_id, NULL, (float)x, (float)y);
 }
 
 /**
-* Creates a tab control
+* set_translation() for the widget with the given id, from any thread, like
+* post_set_text().
 */
-Widget create_tabs_container()
+bool post_set_translation(const char* widget_id, float x, float y)
 {
-	return create("tabset");
+	return _post(POST_TRANSLATION, widget_id, NULL, x, y);
 }
 
 /**
-* Adds a tab to a tab control
+* Drains the posted changes, coalesces them and applies them to whichever
+* window has each widget.
 */
-Widget create_tab(Widget tabset, const char* title, Widget content)
+static void _apply_posted()
 {
 	struct enstate* enstate = GetEngineState();
+	std::vector<_posted>& pending = enstate->posts_pending;
+	std::unordered_map<std::string, size_t>& latest = enstate->posts_latest;
 
-	Rocket::Controls::ElementTabSet* tab = (Rocket::Controls::ElementTabSet*)enstate->document->CreateElement("tab");
-	tab->SetInnerRML(title);
-	tabset->AppendChild(tab);
+	if (enstate->posts.Empty())
+		return;
 
-	Rocket::Core::Element* panel = enstate->document->CreateElement("panel");
-	panel->AppendChild(content);
-	tabset->AppendChild(panel);
-	
-	return tab;
+	pending.clear();
+	latest.clear();
+
+	// at most one ring's worth, so a producer can't keep the frame here
+	std::string key;
+	for (int i = 0; i < MINGUI_POST_RING_SIZE; i++)
+	{
+		bool consumed = enstate->posts.TryConsume([&](const _posted& p)
+		{
+			key.assign(p.id);
+			key += '\n';
+			key += (char)('0' + p.op);
+
+			std::unordered_map<std::string, size_t>::iterator it = latest.find(key);
+			if (it == latest.end())
+			{
+				latest[key] = pending.size();
+				pending.push_back(p);
+			}
+			else
+			{
+				pending[it->second] = p;
+				enstate->posts_coalesced++;
+			}
+		});
+
+		if (!consumed)
+			break;
+	}
+
+	struct winstate* current = enstate->current;
+	for (size_t i = 0; i < enstate->windows.size(); i++)
+	{
+		enstate->current = enstate->windows[i];
+		batch_scope batch;
+
+		for (size_t j = 0; j < pending.size(); j++)
+		{
+			_posted& p = pending[j];
+			if (p.op == POST_DONE)
+				continue;
+
+			Widget w = get_widget_by_id(p.id);
+			if (w == NULL)
+				continue;
+
+			switch (p.op)
+			{
+			case POST_TEXT:			set_text(w, p.text); break;
+			case POST_POSITION:		set_position(w, (int)p.x, (int)p.y); break;
+			case POST_TRANSLATION:	set_translation(w, p.x, p.y); break;
+			}
+
+			p.op = POST_DONE;
+			enstate->posts_applied++;
+		}
+	}
+	enstate->current = current;
 }
 
 /**
-* Sets a widget's property
+* How many posted changes were applied, how many were replaced by a later
+* change to the same widget before they could be, and how many were dropped
+* because the queue was full, since startup.
 */
-inline void set_prop(Widget w, const char* prop, const char* val)
+void get_post_stats(int* applied, int* coalesced, int* dropped)
 {
-	w->SetProperty(prop, val);
+	struct enstate* enstate = GetEngineState();
+	*applied = enstate->posts_applied;
+	*coalesced = enstate->posts_coalesced;
+	*dropped = enstate->posts_dropped;
 }
 
 /**
-* Loads a document
+* Switches the main loop to virtual time: every frame advances the clock by
+* exactly frame_ms, real input is ignored (only injected events are seen,
+* though windows can still be closed and resized), and frames are not paced
+* by vsync. If max_frames is non-zero, the game
+* exits after that many frames. Call before StartGame().
 */
-void load_document(const char* file)
+void set_virtual_time(float frame_ms, int max_frames = 0)
 {
 	struct enstate* enstate = GetEngineState();
-	enstate->context->UnloadAllDocuments();
-	enstate->document = enstate->context->LoadDocument(file);
+	enstate->virtual_time = true;
+	enstate->frame_delta = frame_ms / 1000.0f;
+	enstate->max_frames = max_frames;
 }
 
 /**
-* Creates a form element
+* Queues an SDL event to be processed on the given frame (0 is the first).
 */
-Widget create_form(const char* type)
+void inject_event(int frame, const SDL_Event& event)
 {
-	Widget w = create("input");
-	w->SetAttribute("type", type);
-	return w;
+	struct enstate* enstate = GetEngineState();
+	std::vector<std::pair<int, SDL_Event> >& events = enstate->injected_events;
+
+	// keep the queue ordered by frame; events on the same frame keep their order
+	std::vector<std::pair<int, SDL_Event> >::iterator it = std::upper_bound(events.begin(), events.end(), std::make_pair(frame, event),
+		[](const std::pair<int, SDL_Event>& a, const std::pair<int, SDL_Event>& b) { return a.first < b.first; });
+	events.insert(it, std::make_pair(frame, event));
 }
 
 /**
-* Creates an image element
+* Queues a key press or release to be processed on the given frame.
 */
-Widget create_image(const char* file)
+void inject_key(int frame, SDL_Keycode key, bool down)
 {
-	Widget w = create("img");
-	w->SetAttribute("src", file);
-	return w;
+	SDL_Event event;
+	memset(&event, 0, sizeof(event));
+	event.type = down ? SDL_KEYDOWN : SDL_KEYUP;
+	event.key.state = down ? 1 : 0;
+	event.key.keysym.sym = key;
+	inject_event(frame, event);
 }
 
 /**
-* Sets layering
+* Number of frames run so far.
 */
-void set_layer(Widget w, int layer)
+int get_frame_count()
 {
-	w->SetProperty("z-index", Rocket::Core::String(100, "%d", layer).CString());
+	return GetEngineState()->frame;
 }
 
 /**
-* Sets attribute
+* Seconds since startup, from the virtual clock when it is enabled.
 */
-void set_attribute(Widget w, const char* k, const char* v)
+float get_elapsed_time()
 {
-	w->SetAttribute(k, v);
+	return GetEngineState()->rsi->GetElapsedTime();
 }
 
 /**
-* Gets attribute
+* The window an SDL event is for. Events without a window (e.g. injected
+* ones) go to the first window.
 */
-const char* get_attribute(Widget w, const char* k)
+static struct winstate* _event_window(const SDL_Event& event)
 {
-	return w->GetAttribute(k)->Get<Rocket::Core::String>().CString();
+	struct enstate* enstate = GetEngineState();
+	Uint32 id = 0;
+
+	switch (event.type)
+	{
+	case SDL_WINDOWEVENT:		id = event.window.windowID; break;
+	case SDL_MOUSEMOTION:		id = event.motion.windowID; break;
+	case SDL_MOUSEBUTTONDOWN:
+	case SDL_MOUSEBUTTONUP:		id = event.button.windowID; break;
+	case SDL_MOUSEWHEEL:		id = event.wheel.windowID; break;
+	case SDL_KEYDOWN:
+	case SDL_KEYUP:				id = event.key.windowID; break;
+	default:					break;
+	}
+
+	for (size_t i = 0; i < enstate->windows.size(); i++)
+		if (enstate->windows[i]->window_id == id)
+			return enstate->windows[i];
+
+	return enstate->windows.empty() ? NULL : enstate->windows[0];
 }
 
 /**
-* Gets the class of a widget
+* Converts window pixels to context coordinates, which differ while a resize
+* is pending and the context is stretched over the window.
 */
-const char* get_widget_class(Widget w)
+static void _window_to_context(struct winstate* window, int& x, int& y)
 {
-	return w->GetClassNames().CString();
+	int width, height;
+	SDL_GetWindowSize(window->screen, &width, &height);
+
+	if (width > 0 && width != window->window_width)
+		x = x * window->window_width / width;
+	if (height > 0 && height != window->window_height)
+		y = y * window->window_height / height;
 }
 
 /**
-* Sets the class of a widget
+* Gives the context the window's new size once it has settled; layout then
+* runs once for the whole resize.
 */
-const char* set_widget_class(Widget w, const char* classes)
+static void _apply_resize(struct winstate* window)
 {
-	w->SetClassNames(classes);
+	if (!window->resize_pending)
+		return;
+
+	// still being dragged; meanwhile the old layout is stretched over the window
+	int debounce = GetEngineState()->resize_debounce_ms;
+	if (debounce > 0 && SDL_GetTicks() - window->resize_ticks < (Uint32)debounce)
+		return;
+
+	window->resize_pending = false;
+	if (window->pending_width == window->window_width && window->pending_height == window->window_height)
+		return;
+
+	window->window_width = window->pending_width;
+	window->window_height = window->pending_height;
+	window->context->SetDimensions(Rocket::Core::Vector2i(window->window_width, window->window_height));
 }
 
 /**
-* Gets a widget by id
+* Delays relayout after a window is resized until its size has stopped
+* changing for ms milliseconds; until then the last layout is stretched to
+* fit. With 0, the default, the layout follows the window every frame.
 */
-Widget get_widget_by_id(const char* id)
+void set_resize_debounce(int ms)
 {
-	return GetEngineState()->document->GetElementById(id);
+	GetEngineState()->resize_debounce_ms = ms > 0 ? ms : 0;
 }
 
 /**
-* Gets a child
+* Forwards one SDL event to the context of the window it is for. While it is
+* processed, that window is the current one, so handlers create widgets in it.
 */
-inline Widget get_child(Widget w, int idx)
+static void _process_event(const SDL_Event& event)
 {
-	return w->GetChild(idx);
+	struct enstate* enstate = GetEngineState();
+	struct winstate* window = _event_window(event);
+
+	if (event.type == SDL_QUIT)
+	{
+		enstate->exit = true;
+		return;
+	}
+
+	if (window == NULL || window->closed)
+		return;
+
+	Rocket::Core::Context* context = window->context;
+	SYSTEMINTERFACE* sysinterface = enstate->rsi;
+
+	struct winstate* current = enstate->current;
+	enstate->current = window;
+
+	switch (event.type)
+	{
+	case SDL_WINDOWEVENT:
+		if (event.window.event == SDL_WINDOWEVENT_CLOSE)
+			close_window(window);
+		else if (event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED)
+		{
+			// a live drag sends a stream of these; only the last size is used
+			window->resize_pending = true;
+			window->pending_width = event.window.data1;
+			window->pending_height = event.window.data2;
+			window->resize_ticks = SDL_GetTicks();
+		}
+		break;
+
+	case SDL_MOUSEMOTION:
+	{
+		int x = event.motion.x, y = event.motion.y;
+		_window_to_context(window, x, y);
+		context->ProcessMouseMove(x, y, sysinterface->GetKeyModifiers());
+		break;
+	}
+	case SDL_MOUSEBUTTONDOWN:
+		context->ProcessMouseButtonDown(sysinterface->TranslateMouseButton(event.button.button), sysinterface->GetKeyModifiers());
+		break;
+
+	case SDL_MOUSEBUTTONUP:
+		context->ProcessMouseButtonUp(sysinterface->TranslateMouseButton(event.button.button), sysinterface->GetKeyModifiers());
+		break;
+
+	case SDL_MOUSEWHEEL:
+		context->ProcessMouseWheel(event.wheel.y, sysinterface->GetKeyModifiers());
+		break;
+
+	case SDL_KEYDOWN:
+	{
+		if (event.key.keysym.sym == SDLK_BACKQUOTE && event.key.keysym.mod == KMOD_LSHIFT)
+		{
+			Rocket::Debugger::SetVisible(!Rocket::Debugger::IsVisible());
+			break;
+		}
+
+		_dispatch_key(event.key);
+		context->ProcessKeyDown(sysinterface->TranslateKey(event.key.keysym.sym), sysinterface->GetKeyModifiers());
+
+		if (event.key.keysym.sym >= SDLK_SPACE)
+			context->ProcessTextInput((Rocket::Core::word)event.key.keysym.sym); // @todo handle shift key
+		else if (event.key.keysym.sym == SDLK_RETURN)
+			context->ProcessTextInput((Rocket::Core::word)'\n');
+
+		break;
+	}
+
+	case SDL_KEYUP:
+	{
+		_dispatch_key(event.key);
+		context->ProcessKeyUp(sysinterface->TranslateKey(event.key.keysym.sym), sysinterface->GetKeyModifiers());
+		break;
+	}
+
+	default:
+		break;
+	}
+
+	// a handler may have picked another window, or closed this one
+	if (enstate->current == window)
+		enstate->current = current;
 }
 
 /**
-* Gets the widget's id
+* Keyboard, mouse, touch and controller events; the ones a virtual time run ignores.
 */
-const char* get_id(Widget w)
+static bool _is_input_event(const SDL_Event& event)
 {
-	return w->GetId().CString();
+	switch (event.type)
+	{
+	case SDL_KEYDOWN:
+	case SDL_KEYUP:
+	case SDL_TEXTEDITING:
+	case SDL_TEXTINPUT:
+	case SDL_MOUSEMOTION:
+	case SDL_MOUSEBUTTONDOWN:
+	case SDL_MOUSEBUTTONUP:
+	case SDL_MOUSEWHEEL:
+	case SDL_JOYAXISMOTION:
+	case SDL_JOYBALLMOTION:
+	case SDL_JOYHATMOTION:
+	case SDL_JOYBUTTONDOWN:
+	case SDL_JOYBUTTONUP:
+	case SDL_CONTROLLERAXISMOTION:
+	case SDL_CONTROLLERBUTTONDOWN:
+	case SDL_CONTROLLERBUTTONUP:
+	case SDL_FINGERDOWN:
+	case SDL_FINGERUP:
+	case SDL_FINGERMOTION:
+	case SDL_MULTIGESTURE:
+	case SDL_DOLLARGESTURE:
+		return true;
+	default:
+		return false;
+	}
 }
 
 /**
-* Forces DOM to refresh
+* Hidden and minimized windows are neither updated nor drawn.
 */
-void widget_refresh_all()
+static bool _window_visible(struct winstate* window)
 {
-	Widget w = create("p");
-	w->RemoveReference();
+	return !window->closed && !(SDL_GetWindowFlags(window->screen) & (SDL_WINDOW_HIDDEN | SDL_WINDOW_MINIMIZED));
 }
 
 
-
-
 /**
- * Main loop.
+ * Main loop. Drives every open window until the game exits or the last window
+ * is closed.
  */
 void StartGame(game_loop_ptr gamePtr)
 {
 	struct enstate* enstate = GetEngineState();
 
-	if (enstate->context == NULL || enstate->document == NULL)
+	if (enstate->windows.empty() || enstate->windows[0]->document == NULL)
 	{
 		Rocket::Core::GetSystemInterface()->LogMessage(Rocket::Core::Log::Type::LT_ERROR, "Window was not initialized. Please call create_window() first.");
 		return;
 	}
 
-	Rocket::Core::Context* context = enstate->context;
 	SYSTEMINTERFACE* sysinterface = enstate->rsi;
-	SDL_Renderer* renderer = enstate->renderer;
 
-	while (!enstate->exit)
-	{
-		SDL_Event event;
+	// frame timing, reported at exit for virtual time runs
+	Uint64 perf_frequency = SDL_GetPerformanceFrequency();
+	Uint64 frame_ticks_total = 0, frame_ticks_min = 0, frame_ticks_max = 0;
 
-		SDL_SetRenderDrawColor(renderer, enstate->clear_r, enstate->clear_g, enstate->clear_b, 255);
-		SDL_RenderClear(renderer);
-		context->Render();
-		SDL_RenderPresent(renderer);
+	if (enstate->virtual_time)
+	{
+		sysinterface->SetVirtualTime(true);
 
-		while (SDL_PollEvent(&event))
+		// run unpaced; the swap interval belongs to the current GL context,
+		// so set it in every window's own context and in its renderer's,
+		// which clearing through the renderer makes current
+		for (size_t i = 0; i < enstate->windows.size(); i++)
 		{
-			switch (event.type)
-			{
-			case SDL_QUIT:
-				enstate->exit = true;
-				break;
-
-			case SDL_MOUSEMOTION:
-				context->ProcessMouseMove(event.motion.x, event.motion.y, sysinterface->GetKeyModifiers());
-				break;
-			case SDL_MOUSEBUTTONDOWN:
-				context->ProcessMouseButtonDown(sysinterface->TranslateMouseButton(event.button.button), sysinterface->GetKeyModifiers());
-				break;
+			struct winstate* window = enstate->windows[i];
+			SDL_GL_MakeCurrent(window->screen, window->glcontext);
+			SDL_GL_SetSwapInterval(0);
+			SDL_RenderClear(window->renderer);
+			SDL_GL_SetSwapInterval(0);
+		}
+	}
 
-			case SDL_MOUSEBUTTONUP:
-				context->ProcessMouseButtonUp(sysinterface->TranslateMouseButton(event.button.button), sysinterface->GetKeyModifiers());
-				break;
+	while (!enstate->exit)
+	{
+		Uint64 frame_start = SDL_GetPerformanceCounter();
+		SDL_Event event;
 
-			case SDL_MOUSEWHEEL:
-				context->ProcessMouseWheel(event.wheel.y, sysinterface->GetKeyModifiers());
-				break;
+		if (enstate->virtual_time)
+			sysinterface->AdvanceVirtualTime(enstate->frame_delta);
 
-			case SDL_KEYDOWN:
+		for (size_t i = 0; i < enstate->windows.size(); i++)
+		{
+			struct winstate* window = enstate->windows[i];
+			if (!_window_visible(window))
 			{
-				if (event.key.keysym.sym == SDLK_BACKQUOTE && event.key.keysym.mod == KMOD_LSHIFT)
-				{
-					Rocket::Debugger::SetVisible(!Rocket::Debugger::IsVisible());
-					break;
-				}
+				window->draw_primitives.clear();
+				window->draw_vertices.clear();
+				window->draw_indices.clear();
+				continue;
+			}
 
-				context->ProcessKeyDown(sysinterface->TranslateKey(event.key.keysym.sym), sysinterface->GetKeyModifiers());
+			// clearing through the window's renderer also makes its GL context current for libRocket
+			SDL_SetRenderDrawColor(window->renderer, window->clear_r, window->clear_g, window->clear_b, 255);
+			SDL_RenderClear(window->renderer);
+			window->rrenderer->SetProjection(window->window_width, window->window_height);
+			_advance_tweens(window);
+			_apply_translations(window);
+			window->context->Render();
+			_render_draw_batch(window);
+			SDL_RenderPresent(window->renderer);
+		}
 
-				if (event.key.keysym.sym >= SDLK_SPACE)
-					context->ProcessTextInput((Rocket::Core::word)event.key.keysym.sym); // @todo handle shift key
-				else if (event.key.keysym.sym == SDLK_RETURN)
-					context->ProcessTextInput((Rocket::Core::word)'\n');
+		while (SDL_PollEvent(&event))
+		{
+			// real input would make a virtual time run non-reproducible;
+			// quitting, closing and resizing windows still work
+			if (!enstate->virtual_time || !_is_input_event(event))
+				_process_event(event);
+		}
 
+		for (; enstate->next_injected_event < enstate->injected_events.size(); enstate->next_injected_event++)
+		{
+			std::pair<int, SDL_Event>& injected = enstate->injected_events[enstate->next_injected_event];
+			if (injected.first > enstate->frame)
 				break;
-			}
 
-			case SDL_KEYUP:
-			{
+			_process_event(injected.second);
+		}
 
-				break;
-			}
+		_repeat_keys();
+		_run_async_completions();
+		_apply_posted();
 
-			default:
-				break;
-			}
+		int touched = 0;
+		for (size_t i = 0; i < enstate->windows.size(); i++)
+		{
+			struct winstate* window = enstate->windows[i];
+			if (!_window_visible(window))
+				continue;
+
+			_apply_resize(window);
+			_apply_bindings(window);
+			touched += _flush_window(window);
+			window->context->Update();
 		}
-		
-		context->Update();
+		enstate->last_flush_touched = touched;
 
 		// run user's code.
 		if (!gamePtr())
 			enstate->exit = true;
+
+		_reap_windows();
+
+		enstate->frame++;
+		if (enstate->max_frames > 0 && enstate->frame >= enstate->max_frames)
+			enstate->exit = true;
+
+		Uint64 frame_ticks = SDL_GetPerformanceCounter() - frame_start;
+		frame_ticks_total += frame_ticks;
+		if (frame_ticks_min == 0 || frame_ticks < frame_ticks_min)
+			frame_ticks_min = frame_ticks;
+		if (frame_ticks > frame_ticks_max)
+			frame_ticks_max = frame_ticks;
 	}
 
-	context->UnloadDocument(enstate->document);
-	context->RemoveReference();
+	if (enstate->virtual_time && enstate->frame > 0)
+	{
+		double ms = 1000.0 / perf_frequency;
+		sysinterface->LogMessage(Rocket::Core::Log::LT_ALWAYS, Rocket::Core::String(256, "%d frames, %.3f ms total, frame avg %.3f ms, min %.3f ms, max %.3f ms",
+			enstate->frame, frame_ticks_total * ms, frame_ticks_total * ms / enstate->frame, frame_ticks_min * ms, frame_ticks_max * ms));
+	}
+
+	// tasks still running may finish, but their done callbacks are not run
+	delete enstate->tasks;
+	enstate->tasks = NULL;
+
+	// contexts go before libRocket shuts down, renderers after, as it releases textures through them
+	for (size_t i = 0; i < enstate->windows.size(); i++)
+		_release_context(enstate->windows[i]);
+
 	Rocket::Core::Shutdown();
 
-	delete enstate->rrenderer;
+	for (size_t i = 0; i < enstate->windows.size(); i++)
+		_destroy_window(enstate->windows[i]);
+	enstate->windows.clear();
+	enstate->current = NULL;
+
 	delete enstate->rsi;
-	
-	SDL_DestroyRenderer(renderer);
-	SDL_DestroyWindow(enstate->screen);
+	enstate->rsi = NULL;
 
 	SDL_Quit();
 }
 
-#endif
\ No newline at end of file
+#endif
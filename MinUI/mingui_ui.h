@@ -0,0 +1,315 @@
+/**
+ * MinGUI
+ * Released under the MIT license, (c) Neil Rao
+ *
+ * Compile-time widget descriptions. A screen is written as one expression,
+ *
+ *	ui::build(ui::text("Program 3", ui::size<28>(), ui::pos<400, 30>()));
+ *
+ * and every property in it is a type. Unknown properties do not compile,
+ * values are checked by static_assert, and each distinct value is turned into
+ * a Rocket::Core::Property once per program instead of being formatted and
+ * parsed every time a widget is built. build() expands into straight-line
+ * code that creates the elements, sets the prebuilt properties and attaches
+ * the tree inside one batch, so the document is laid out once.
+ */
+
+#ifndef MINGUI_UI_H_
+#define MINGUI_UI_H_
+
+#include "mingui.h"
+
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace ui
+{
+
+// every modifier derives from this, so nodes can tell modifiers from children
+struct modifier {};
+
+// prebuilt property values; one static per distinct (property, value)
+
+template <typename P, int Value, PropertyUnit Unit>
+inline void _set_length(Widget w)
+{
+	static_assert(P::kind == PROP_LENGTH || P::kind == PROP_NUMBER, "property does not take a length or number");
+	static const Rocket::Core::Property property((float)Value, Unit);
+	_set_property(w, P::name(), property);
+}
+
+template <typename P, int Keyword>
+inline void _set_keyword(Widget w)
+{
+	static_assert(P::kind == PROP_KEYWORD, "property does not take a keyword");
+	static const Rocket::Core::Property property(Keyword, Rocket::Core::Property::KEYWORD);
+	_set_property(w, P::name(), property);
+}
+
+template <typename P, unsigned int RGBA>
+inline void _set_colour(Widget w)
+{
+	static_assert(P::kind == PROP_COLOUR, "property does not take a colour");
+	static const Rocket::Core::Property property(Rocket::Core::Colourb((Rocket::Core::byte)(RGBA >> 24), (Rocket::Core::byte)(RGBA >> 16), (Rocket::Core::byte)(RGBA >> 8), (Rocket::Core::byte)RGBA), Rocket::Core::Property::COLOUR);
+	_set_property(w, P::name(), property);
+}
+
+
+// modifiers
+
+/**
+ * Font size in pixels.
+ */
+template <int Px>
+struct size : modifier
+{
+	static_assert(Px > 0, "ui::size must be positive");
+	static void apply(Widget w) { _set_length<FontSize, Px, PX>(w); }
+};
+
+/**
+ * Absolute position in pixels, like set_position().
+ */
+template <int X, int Y>
+struct pos : modifier
+{
+	static void apply(Widget w)
+	{
+		_set_keyword<Position, Rocket::Core::POSITION_ABSOLUTE>(w);
+		_set_length<MarginTop, Y, PX>(w);
+		_set_length<MarginRight, X, PX>(w);
+		_set_length<MarginBottom, Y, PX>(w);
+		_set_length<MarginLeft, X, PX>(w);
+	}
+};
+
+template <int Px>
+struct width : modifier
+{
+	static_assert(Px >= 0, "ui::width cannot be negative");
+	static void apply(Widget w) { _set_length<Width, Px, PX>(w); }
+};
+
+template <int Px>
+struct height : modifier
+{
+	static_assert(Px >= 0, "ui::height cannot be negative");
+	static void apply(Widget w) { _set_length<Height, Px, PX>(w); }
+};
+
+template <int Px>
+struct padding : modifier
+{
+	static_assert(Px >= 0, "ui::padding cannot be negative");
+	static void apply(Widget w)
+	{
+		_set_length<PaddingTop, Px, PX>(w);
+		_set_length<PaddingRight, Px, PX>(w);
+		_set_length<PaddingBottom, Px, PX>(w);
+		_set_length<PaddingLeft, Px, PX>(w);
+	}
+};
+
+/**
+ * Stacking order, like set_layer().
+ */
+template <int Z>
+struct layer : modifier
+{
+	static void apply(Widget w) { _set_length<ZIndex, Z, NUMBER>(w); }
+};
+
+/**
+ * FONT_BOLD, FONT_ITALIC or FONT_BOLD_AND_ITALIC.
+ */
+template <int Flags>
+struct style : modifier
+{
+	static_assert((Flags & ~FONT_BOLD_AND_ITALIC) == 0, "ui::style takes FONT_BOLD and FONT_ITALIC flags");
+	static void apply(Widget w)
+	{
+		_set_keyword<FontWeight, Flags & FONT_BOLD ? Rocket::Core::FONT_WEIGHT_BOLD : Rocket::Core::FONT_WEIGHT_NORMAL>(w);
+		_set_keyword<FontStyle, Flags & FONT_ITALIC ? Rocket::Core::FONT_STYLE_ITALIC : Rocket::Core::FONT_STYLE_NORMAL>(w);
+	}
+};
+
+struct center : modifier
+{
+	static void apply(Widget w) { _set_keyword<TextAlign, Rocket::Core::TEXT_ALIGN_CENTER>(w); }
+};
+
+/**
+ * Text colour as 0xRRGGBBAA.
+ */
+template <unsigned int RGBA>
+struct color : modifier
+{
+	static void apply(Widget w) { _set_colour<Color, RGBA>(w); }
+};
+
+template <unsigned int RGBA>
+struct background : modifier
+{
+	static void apply(Widget w) { _set_colour<BackgroundColor, RGBA>(w); }
+};
+
+template <int Px, unsigned int RGBA>
+struct border : modifier
+{
+	static_assert(Px >= 0, "ui::border width cannot be negative");
+	static void apply(Widget w)
+	{
+		_set_length<BorderTopWidth, Px, PX>(w);
+		_set_length<BorderRightWidth, Px, PX>(w);
+		_set_length<BorderBottomWidth, Px, PX>(w);
+		_set_length<BorderLeftWidth, Px, PX>(w);
+		_set_colour<BorderTopColor, RGBA>(w);
+		_set_colour<BorderRightColor, RGBA>(w);
+		_set_colour<BorderBottomColor, RGBA>(w);
+		_set_colour<BorderLeftColor, RGBA>(w);
+	}
+};
+
+// strings can't be template arguments, so these carry theirs as a member
+
+/**
+ * Font family, by the name the font registered itself under.
+ */
+struct font : modifier
+{
+	explicit font(const char* family) : family(family) {}
+	void apply(Widget w) const { _set_property(w, "font-family", Rocket::Core::Property(Rocket::Core::String(family), Rocket::Core::Property::STRING)); }
+
+	const char* family;
+};
+
+struct id : modifier
+{
+	explicit id(const char* value) : value(value) {}
+	void apply(Widget w) const { w->SetId(value); }
+
+	const char* value;
+};
+
+struct class_name : modifier
+{
+	explicit class_name(const char* value) : value(value) {}
+	void apply(Widget w) const { w->SetClassNames(value); }
+
+	const char* value;
+};
+
+
+// nodes
+
+/**
+ * One element: its tag, optional text and attribute, and its modifiers and
+ * children in the order they were written.
+ */
+template <typename... Args>
+struct node
+{
+	const char* tag;
+	const char* text;
+	const char* attribute;
+	const char* value;
+	std::tuple<Args...> args;
+};
+
+template <typename T>
+struct _is_node : std::false_type {};
+
+template <typename... Args>
+struct _is_node<node<Args...> > : std::true_type {};
+
+template <typename... Args>
+struct _all_args;
+
+template <>
+struct _all_args<> : std::true_type {};
+
+template <typename T, typename... Rest>
+struct _all_args<T, Rest...> : std::integral_constant<bool, (std::is_base_of<modifier, T>::value || _is_node<T>::value) && _all_args<Rest...>::value> {};
+
+template <typename... Args>
+inline node<Args...> _make(const char* tag, const char* text, const char* attribute, const char* value, const Args&... args)
+{
+	static_assert(_all_args<Args...>::value, "ui nodes take ui:: modifiers and ui:: nodes only");
+	node<Args...> n = { tag, text, attribute, value, std::tuple<Args...>(args...) };
+	return n;
+}
+
+template <typename... Args>
+inline node<Args...> text(const char* text, const Args&... args) { return _make("p", text, NULL, NULL, args...); }
+
+template <typename... Args>
+inline node<Args...> button(const char* text, const Args&... args) { return _make("button", text, NULL, NULL, args...); }
+
+template <typename... Args>
+inline node<Args...> image(const char* src, const Args&... args) { return _make("img", NULL, "src", src, args...); }
+
+template <typename... Args>
+inline node<Args...> box(const Args&... args) { return _make("div", NULL, NULL, NULL, args...); }
+
+
+// construction
+
+template <typename... Args>
+Widget _build(const node<Args...>& n);
+
+template <typename M>
+inline void _apply(Widget w, const M& m, std::true_type /* modifier */)
+{
+	m.apply(w);
+}
+
+template <typename N>
+inline void _apply(Widget w, const N& child, std::false_type /* node */)
+{
+	_attach(_build(child), w);
+}
+
+template <typename... Args, size_t... I>
+inline void _apply_all(Widget w, const std::tuple<Args...>& args, std::index_sequence<I...>)
+{
+	int expand[] = { 0, (_apply(w, std::get<I>(args), std::is_base_of<modifier, Args>()), 0)... };
+	(void)expand;
+}
+
+template <typename... Args>
+Widget _build(const node<Args...>& n)
+{
+	struct winstate* window = GetWindowState();
+	Widget w = _create_element(window, n.tag, n.text);
+
+	if (n.attribute != NULL)
+		w->SetAttribute(n.attribute, n.value);
+
+	_apply_all(w, n.args, std::index_sequence_for<Args...>());
+
+	// indexed here rather than from the top once attached: in a batch, the
+	// children are only staged, so a walk down from the top doesn't see them
+	if (!w->GetId().Empty() || w->HasAttribute("class"))
+		_index(w);
+
+	return w;
+}
+
+/**
+ * Builds a description into the current window, under parent or the root
+ * node, and returns its top widget.
+ */
+template <typename... Args>
+Widget build(const node<Args...>& n, Widget parent = NULL)
+{
+	batch_scope batch;
+
+	Widget w = _build(n);
+	_attach(w, parent);
+	return w;
+}
+
+}
+
+#endif